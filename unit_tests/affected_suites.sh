@@ -0,0 +1,46 @@
+#!/bin/bash
+# Prints the test suites affected by changes since a git revision, one per line.
+# A suite is affected when a changed file is its source, a header it includes
+# (directly or through other headers, as recorded in the -MMD dependency
+# files), anything the shared test_framework.o or suite_main.o is built from,
+# or the Makefile.
+# Suites without a dependency file have not been built with them yet and are
+# always listed.
+#
+# Usage: affected_suites.sh [BUILD_DIR] [BASE]   (defaults: build, HEAD)
+
+BUILD_DIR="${1:-build}"
+BASE="${2:-HEAD}"
+
+# Dependency files name sources relative to the directory holding the Makefile
+cd "$(dirname "$0")/.." || exit 1
+
+if ! git rev-parse --verify --quiet "$BASE^{commit}" > /dev/null; then
+    echo "Unknown revision: $BASE" >&2
+    exit 1
+fi
+
+# Committed, staged and unstaged changes since BASE, plus new untracked files
+changed=$( { git diff --name-only --relative "$BASE" -- && git ls-files --others --exclude-standard; } | sort -u )
+[ -n "$changed" ] || exit 0
+
+# Every path named in a make dependency file, one per line
+dependencies_of() {
+    sed -e 's/\\$//' -e 's/:/ /g' "$1" | tr ' \t' '\n\n' | grep -v '^$'
+}
+
+framework_deps="$BUILD_DIR/test_framework.o.d"
+main_deps="$BUILD_DIR/suite_main.o.d"
+for test_exe in "$BUILD_DIR"/test_*; do
+    [ -x "$test_exe" ] && [ -f "$test_exe" ] || continue
+    suite=$(basename "$test_exe")
+    if [ ! -f "$test_exe.o.d" ] || [ ! -f "$framework_deps" ] || [ ! -f "$main_deps" ]; then
+        echo "$suite"
+        continue
+    fi
+    deps=$( { dependencies_of "$test_exe.o.d"; dependencies_of "$framework_deps"; dependencies_of "$main_deps";
+              echo Makefile; } | sort -u )
+    if [ -n "$(comm -12 <(echo "$changed") <(echo "$deps"))" ]; then
+        echo "$suite"
+    fi
+done
@@ -0,0 +1,426 @@
+/******************************************************************************
+* Copyright 2015-2022 Xilinx, Inc.
+* Copyright 2022-2023 Advanced Micro Devices, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+******************************************************************************/
+
+// Compares the benchmarks of two builds of a test binary on this machine, in
+// one sitting. Numbers from different days or CI hosts differ by more than
+// most optimizations are worth, so both builds are run back to back: every
+// round visits the benchmarks in a fresh random order, and for each one runs
+// both builds, the one going first picked at random. Drift in clock speed,
+// heat or background load therefore lands on both sides alike.
+//
+// Each run records its samples with --bench-save-baseline. The median time
+// per iteration of A's run divided by B's is one ratio per round; the speedup
+// reported is the median of those ratios, with a distribution-free confidence
+// interval from their order statistics.
+
+#include "test_statistics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace {
+
+struct CompareOptions {
+    unsigned rounds = 15;
+    double confidence = 0.95;
+    bool seeded = false;
+    unsigned seed = 0;
+    bool benchIsolate = true;           // Pass --bench-isolate to both builds
+    std::string filter;                 // Non-empty: only benchmarks matching these globs
+    std::vector<std::string> suiteArgs; // Everything after "--", passed to both builds
+};
+
+struct Build {
+    std::string label;                  // "A" or "B"
+    std::string path;
+    unsigned runs = 0;
+    unsigned busyRuns = 0;              // Runs that --bench-isolate judged not quiet
+};
+
+struct BenchmarkRounds {
+    std::string name;
+    std::vector<double> samplesA;       // ns per iteration over every round
+    std::vector<double> samplesB;
+    std::vector<double> ratios;         // A median / B median, one per round
+};
+
+std::string format_nanoseconds(double value) {
+    const char* unit = "ns";
+    if (value >= 1e9) {
+        value /= 1e9;
+        unit = "s";
+    } else if (value >= 1e6) {
+        value /= 1e6;
+        unit = "ms";
+    } else if (value >= 1e3) {
+        value /= 1e3;
+        unit = "us";
+    }
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(value < 10.0 ? 2 : 1) << value << " " << unit;
+    return text.str();
+}
+
+std::string format_ratio(double ratio) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3) << ratio << "x";
+    return text.str();
+}
+
+#ifndef _WIN32
+
+// Runs a build with the arguments in 'dir', its output appended to 'log';
+// returns its exit code, or -1 if it could not be run or was killed
+int run_build(const std::string& path, const std::vector<std::string>& arguments, const std::string& dir,
+              const std::string& log) {
+    std::vector<std::string> args(1, path);
+    args.insert(args.end(), arguments.begin(), arguments.end());
+    std::vector<char*> argv;
+    for (auto& arg : args) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    // Both builds see only the options given here, never the caller's BOOTGEN_TEST_*
+    std::vector<char*> env;
+    for (char** entry = environ; entry && *entry; ++entry) {
+        if (std::strncmp(*entry, "BOOTGEN_TEST_", 13) != 0) env.push_back(*entry);
+    }
+    env.push_back(nullptr);
+
+    std::cout.flush();
+    pid_t pid = ::fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int fd = -1;
+        if (::chdir(dir.c_str()) == 0) {
+            fd = ::open(log.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        }
+        if (fd < 0) _exit(127);
+        ::dup2(fd, STDOUT_FILENO);
+        ::dup2(fd, STDERR_FILENO);
+        ::close(fd);
+        ::execve(argv[0], argv.data(), env.data());
+        _exit(127);
+    }
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Benchmark names a build lists with --list; its banner lines contain spaces
+bool list_benchmarks(const Build& build, const CompareOptions& options, const std::string& dir,
+                     std::vector<std::string>& names) {
+    std::vector<std::string> args;
+    args.push_back("--benchmarks-only");
+    args.push_back("--list");
+    if (!options.filter.empty()) args.push_back("--filter=" + options.filter);
+    const std::string log = "list_" + build.label + ".log";
+    if (run_build(build.path, args, dir, log) != 0) return false;
+    std::ifstream in((dir + "/" + log).c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.erase(line.size() - 1);
+        if (line.empty() || line.find_first_of(" \t") != std::string::npos || line.find('.') == std::string::npos) {
+            continue;
+        }
+        names.push_back(line);
+    }
+    return true;
+}
+
+// Samples of one benchmark from a --bench-save-baseline file:
+// "<benchmark>\t<iterations>\t<ns per iteration>..."
+bool read_samples(const std::string& path, const std::string& name, std::vector<double>& samples) {
+    std::ifstream in(path.c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string benchmark;
+        unsigned long long iterations;
+        if (!std::getline(fields, benchmark, '\t') || benchmark != name || !(fields >> iterations)) continue;
+        double value;
+        while (fields >> value) samples.push_back(value);
+        return !samples.empty();
+    }
+    return false;
+}
+
+// One run of one benchmark; appends its samples and returns false if it failed
+bool measure(Build& build, const std::string& name, const CompareOptions& options, const std::string& dir,
+             std::vector<double>& samples) {
+    const std::string baseline = "samples_" + build.label + ".txt";
+    const std::string jsonl = "run_" + build.label + ".jsonl";
+    std::remove((dir + "/" + baseline).c_str());
+    std::vector<std::string> args;
+    args.push_back("--benchmarks-only");
+    args.push_back("--no-history");
+    args.push_back("--filter=" + name);
+    args.push_back("--bench-save-baseline=" + baseline);
+    args.push_back("--report-jsonl=" + jsonl);
+    if (options.benchIsolate) args.push_back("--bench-isolate");
+    args.insert(args.end(), options.suiteArgs.begin(), options.suiteArgs.end());
+    if (run_build(build.path, args, dir, "build_" + build.label + ".log") != 0) return false;
+    build.runs++;
+
+    std::vector<double> run;
+    if (!read_samples(dir + "/" + baseline, name, run)) return false;
+    samples.insert(samples.end(), run.begin(), run.end());
+
+    std::ifstream report((dir + "/" + jsonl).c_str());
+    std::string line;
+    while (std::getline(report, line)) {
+        if (line.find("\"quiet\":false") != std::string::npos) build.busyRuns++;
+    }
+    return true;
+}
+
+void remove_directory(const std::string& dir) {
+    if (DIR* handle = ::opendir(dir.c_str())) {
+        while (struct dirent* entry = ::readdir(handle)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") std::remove((dir + "/" + name).c_str());
+        }
+        ::closedir(handle);
+    }
+    ::rmdir(dir.c_str());
+}
+
+std::string absolute_path(const std::string& path) {
+    char resolved[PATH_MAX];
+    return ::realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+}
+
+#endif // _WIN32
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options] BUILD_A BUILD_B [-- test options]" << std::endl;
+    std::cout << "Runs the benchmarks of two builds of a test binary interleaved in random order and reports" << std::endl;
+    std::cout << "the speedup of B over A (A time / B time) per benchmark." << std::endl;
+    std::cout << "  --rounds N              Runs of every benchmark per build (default 15)" << std::endl;
+    std::cout << "  --confidence P          Coverage of the speedup interval (default 0.95)" << std::endl;
+    std::cout << "  --filter=GLOBS          Compare only benchmarks matching one of the ':'-separated globs" << std::endl;
+    std::cout << "  --seed N                Seed of the run order, to repeat a comparison" << std::endl;
+    std::cout << "  --no-bench-isolate      Do not pass --bench-isolate to the builds" << std::endl;
+    std::cout << "Options after -- go to both builds, e.g. -- --bench-time 10 --bench-samples 20" << std::endl;
+}
+
+bool parse_number(const char* text, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtod(text, &end);
+    return errno == 0 && end != text && *end == '\0';
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    CompareOptions options;
+    std::vector<std::string> builds;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        double value;
+        if (arg == "--") {
+            options.suiteArgs.assign(argv + i + 1, argv + argc);
+            break;
+        } else if ((arg == "--rounds" || arg == "--confidence" || arg == "--seed") && i + 1 < argc) {
+            const char* text = argv[++i];
+            bool valid = parse_number(text, value) && value > 0;
+            if (arg == "--rounds" && valid && value == std::floor(value) && value <= 100000) {
+                options.rounds = static_cast<unsigned>(value);
+            } else if (arg == "--confidence" && valid && value < 1) {
+                options.confidence = value;
+            } else if (arg == "--seed" && parse_number(text, value) && value >= 0 && value == std::floor(value) &&
+                       value <= 4294967295.0) {
+                options.seed = static_cast<unsigned>(value);
+                options.seeded = true;
+            } else {
+                std::cerr << "Invalid value for " << arg << ": " << text << std::endl;
+                return 2;
+            }
+        } else if (arg.compare(0, 9, "--filter=") == 0) {
+            options.filter = arg.substr(9);
+        } else if (arg == "--no-bench-isolate") {
+            options.benchIsolate = false;
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 2;
+        } else {
+            builds.push_back(arg);
+        }
+    }
+    if (builds.size() != 2) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+#ifdef _WIN32
+    std::cerr << "bootgen_bench_compare needs a POSIX system" << std::endl;
+    return 2;
+#else
+    Build a;
+    Build b;
+    a.label = "A";
+    b.label = "B";
+    a.path = absolute_path(builds[0]);
+    b.path = absolute_path(builds[1]);
+    for (const std::string& path : { a.path, b.path }) {
+        if (::access(path.c_str(), X_OK) != 0) {
+            std::cerr << "Not an executable: " << path << std::endl;
+            return 2;
+        }
+    }
+    if (a.path == b.path) {
+        std::cout << "Both builds are the same binary; the speedups measure the noise of this setup" << std::endl;
+    }
+
+    const char* tmp = std::getenv("TMPDIR");
+    std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/bootgen_bench_compare.XXXXXX";
+    std::vector<char> buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+    if (!::mkdtemp(buffer.data())) {
+        std::cerr << "Cannot create a work directory: " << std::strerror(errno) << std::endl;
+        return 2;
+    }
+    const std::string dir = buffer.data();
+
+    std::vector<std::string> names_a;
+    std::vector<std::string> names_b;
+    if (!list_benchmarks(a, options, dir, names_a) || !list_benchmarks(b, options, dir, names_b)) {
+        std::cerr << "Could not list the benchmarks of both builds; see the logs in " << dir << std::endl;
+        return 1;
+    }
+    std::vector<BenchmarkRounds> benchmarks;
+    for (const std::string& name : names_a) {
+        if (std::find(names_b.begin(), names_b.end(), name) == names_b.end()) {
+            std::cout << "Only in A, skipped: " << name << std::endl;
+            continue;
+        }
+        BenchmarkRounds rounds;
+        rounds.name = name;
+        benchmarks.push_back(rounds);
+    }
+    for (const std::string& name : names_b) {
+        if (std::find(names_a.begin(), names_a.end(), name) == names_a.end()) {
+            std::cout << "Only in B, skipped: " << name << std::endl;
+        }
+    }
+    if (benchmarks.empty()) {
+        std::cout << "No benchmarks common to both builds" << std::endl;
+        remove_directory(dir);
+        return 1;
+    }
+
+    if (!options.seeded) options.seed = std::random_device()();
+    std::mt19937 random(options.seed);
+    std::cout << "A: " << a.path << std::endl;
+    std::cout << "B: " << b.path << std::endl;
+    std::cout << benchmarks.size() << " benchmark" << (benchmarks.size() > 1 ? "s" : "") << ", "
+              << options.rounds << " rounds in random order (--seed " << options.seed << ")" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<size_t> order(benchmarks.size());
+    for (size_t k = 0; k < order.size(); ++k) order[k] = k;
+    for (unsigned round = 1; round <= options.rounds; ++round) {
+        std::shuffle(order.begin(), order.end(), random);
+        for (size_t index : order) {
+            BenchmarkRounds& benchmark = benchmarks[index];
+            const bool a_first = std::bernoulli_distribution(0.5)(random);
+            std::vector<double> run_a;
+            std::vector<double> run_b;
+            bool ok = a_first ? measure(a, benchmark.name, options, dir, run_a) &&
+                                    measure(b, benchmark.name, options, dir, run_b)
+                              : measure(b, benchmark.name, options, dir, run_b) &&
+                                    measure(a, benchmark.name, options, dir, run_a);
+            if (!ok) {
+                std::cerr << benchmark.name << " failed in round " << round << "; see the logs in " << dir
+                          << std::endl;
+                return 1;
+            }
+            benchmark.samplesA.insert(benchmark.samplesA.end(), run_a.begin(), run_a.end());
+            benchmark.samplesB.insert(benchmark.samplesB.end(), run_b.begin(), run_b.end());
+            const double median_b = median_of(run_b);
+            if (median_b > 0.0) benchmark.ratios.push_back(median_of(run_a) / median_b);
+        }
+        std::cout << "Round " << round << " of " << options.rounds << " done" << std::endl;
+    }
+    remove_directory(dir);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t width = 9;
+    for (const BenchmarkRounds& benchmark : benchmarks) width = std::max(width, benchmark.name.size());
+    std::ostringstream interval_title;
+    interval_title << std::setprecision(3) << options.confidence * 100.0 << "% interval";
+    std::cout << std::endl << std::left << std::setw(static_cast<int>(width) + 2) << "Benchmark" << std::setw(12)
+              << "A median" << std::setw(12) << "B median" << std::setw(10) << "Speedup" << std::setw(22)
+              << interval_title.str() << "Verdict" << std::endl;
+    double lowest_coverage = 1.0;
+    for (const BenchmarkRounds& benchmark : benchmarks) {
+        MedianInterval interval = median_interval(benchmark.ratios, options.confidence);
+        lowest_coverage = std::min(lowest_coverage, interval.coverage);
+        const char* verdict = interval.low > 1.0 ? "B faster" : interval.high < 1.0 ? "B slower" : "no clear difference";
+        std::cout << std::left << std::setw(static_cast<int>(width) + 2) << benchmark.name << std::setw(12)
+                  << format_nanoseconds(median_of(benchmark.samplesA)) << std::setw(12)
+                  << format_nanoseconds(median_of(benchmark.samplesB)) << std::setw(10)
+                  << format_ratio(median_of(benchmark.ratios)) << std::setw(22)
+                  << ("[" + format_ratio(interval.low) + ", " + format_ratio(interval.high) + "]") << verdict
+                  << std::endl;
+    }
+    std::cout << std::endl << "Speedup is A time / B time, the median over " << options.rounds
+              << " rounds; above 1 B is faster. Took " << std::fixed << std::setprecision(1) << wall << " s."
+              << std::endl;
+    if (lowest_coverage < options.confidence) {
+        std::cout << "Too few rounds for " << std::setprecision(0) << options.confidence * 100.0
+                  << "% intervals; the ranges shown cover " << std::setprecision(1) << lowest_coverage * 100.0
+                  << "%. Use more --rounds." << std::endl;
+    }
+    if (a.busyRuns + b.busyRuns > 0) {
+        std::cout << "The machine was busy during " << a.busyRuns << " of " << a.runs << " runs of A and "
+                  << b.busyRuns << " of " << b.runs << " of B; interleaving spreads that noise over both builds,"
+                  << " but it widens the intervals." << std::endl;
+    }
+    return 0;
+#endif
+}
@@ -0,0 +1,317 @@
+/******************************************************************************
+* Copyright 2015-2022 Xilinx, Inc.
+* Copyright 2022-2023 Advanced Micro Devices, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+******************************************************************************/
+
+// Queries the performance history that test binaries append to with
+// --history-store. Values are grouped per commit in the order the commits
+// were first recorded, so a store fed by CI on every merge reads as a
+// timeline. A move is located by trying every commit boundary as a split and
+// keeping the one where a rank-sum test separates the values before and after
+// most clearly; this finds both sudden jumps and slow creep, which no single
+// run-to-run comparison would flag.
+
+#include "test_history.h"
+#include "test_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CommitValues {
+    std::string commit;
+    std::vector<double> values;
+};
+
+struct Shift {
+    bool found = false;
+    size_t at = 0;          // Index of the first commit after the move
+    double before = 0.0;    // Median of all values before / from 'at'
+    double after = 0.0;
+    double pValue = 1.0;    // Two-sided, for the chosen split (not corrected for the search)
+};
+
+struct QueryOptions {
+    double alpha = 0.01;
+    double minChange = 5.0;     // Percent
+};
+
+bool is_time_metric(const std::string& metric) {
+    return metric.size() > 3 && metric.compare(metric.size() - 3, 3, "_ns") == 0;
+}
+
+std::string format_value(const std::string& metric, double value) {
+    std::ostringstream text;
+    if (!is_time_metric(metric)) {
+        text << std::fixed << std::setprecision(value == std::floor(value) ? 0 : 3) << value;
+        return text.str();
+    }
+    const char* unit = "ns";
+    if (value >= 1e9) {
+        value /= 1e9;
+        unit = "s";
+    } else if (value >= 1e6) {
+        value /= 1e6;
+        unit = "ms";
+    } else if (value >= 1e3) {
+        value /= 1e3;
+        unit = "us";
+    }
+    text << std::fixed << std::setprecision(3) << value << " " << unit;
+    return text.str();
+}
+
+std::string format_change(double from, double to) {
+    if (from == 0.0) return "-";
+    std::ostringstream text;
+    text << std::showpos << std::fixed << std::setprecision(1) << (to - from) / from * 100.0 << "%";
+    return text.str();
+}
+
+// Values of one (test, metric) series grouped by commit, oldest commit first
+std::vector<CommitValues> series_of(const perf_history::Store& store, uint32_t test, uint32_t metric) {
+    std::vector<CommitValues> series;
+    std::map<uint32_t, size_t> slot;
+    for (const perf_history::Sample& sample : store.samples) {
+        if (sample.test != test || sample.metric != metric) continue;
+        uint32_t commit = store.runs[sample.run].commit;
+        auto found = slot.find(commit);
+        if (found == slot.end()) {
+            found = slot.insert(std::make_pair(commit, series.size())).first;
+            series.push_back(CommitValues());
+            series.back().commit = store.name(commit);
+        }
+        series[found->second].values.push_back(sample.value);
+    }
+    return series;
+}
+
+Shift find_shift(const std::vector<CommitValues>& series) {
+    Shift best;
+    double best_z = 0.0;
+    for (size_t at = 1; at < series.size(); ++at) {
+        std::vector<double> before;
+        std::vector<double> after;
+        for (size_t k = 0; k < series.size(); ++k) {
+            std::vector<double>& side = k < at ? before : after;
+            side.insert(side.end(), series[k].values.begin(), series[k].values.end());
+        }
+        RankSumTest test = mann_whitney_greater(after, before);
+        if (!best.found || test.zTwoSided > best_z) {
+            best.found = true;
+            best_z = test.zTwoSided;
+            best.at = at;
+            best.before = median_of(before);
+            best.after = median_of(after);
+            best.pValue = test.pTwoSided;
+        }
+    }
+    return best;
+}
+
+// Size of a move relative to the level before it, as format_change shows it
+double relative_change(const Shift& shift) {
+    return std::fabs(shift.after - shift.before) / shift.before;
+}
+
+bool significant(const Shift& shift, const QueryOptions& options) {
+    if (!shift.found || shift.pValue >= options.alpha || shift.before == 0.0) return false;
+    return relative_change(shift) * 100.0 >= options.minChange;
+}
+
+bool lookup(const perf_history::Store& store, const std::string& text, uint32_t& id) {
+    for (size_t i = 0; i < store.strings.size(); ++i) {
+        if (store.strings[i] == text) {
+            id = static_cast<uint32_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Benchmarks are judged by their per-iteration median, plain tests by duration
+std::string default_metric(const perf_history::Store& store, uint32_t test) {
+    uint32_t bench;
+    if (lookup(store, "bench_median_ns", bench)) {
+        for (const perf_history::Sample& sample : store.samples) {
+            if (sample.test == test && sample.metric == bench) return "bench_median_ns";
+        }
+    }
+    return "duration_ns";
+}
+
+int list_tests(const perf_history::Store& store) {
+    std::map<std::pair<uint32_t, uint32_t>, size_t> counts;
+    for (const perf_history::Sample& sample : store.samples) {
+        counts[std::make_pair(sample.test, sample.metric)]++;
+    }
+    std::map<std::string, std::vector<std::string> > metrics;
+    for (const auto& entry : counts) {
+        std::ostringstream metric;
+        metric << store.name(entry.first.second) << " (" << entry.second << ")";
+        metrics[store.name(entry.first.first)].push_back(metric.str());
+    }
+    std::cout << store.runs.size() << " runs, " << store.samples.size() << " records" << std::endl;
+    for (const auto& test : metrics) {
+        std::cout << test.first << ":";
+        for (const auto& metric : test.second) std::cout << " " << metric;
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+int print_trend(const perf_history::Store& store, const std::string& test_name, std::string metric,
+                const QueryOptions& options) {
+    uint32_t test;
+    uint32_t metric_id;
+    if (!lookup(store, test_name, test)) {
+        std::cerr << "No history for test " << test_name << std::endl;
+        return 1;
+    }
+    if (metric.empty()) metric = default_metric(store, test);
+    std::vector<CommitValues> series;
+    if (lookup(store, metric, metric_id)) series = series_of(store, test, metric_id);
+    if (series.empty()) {
+        std::cerr << "No " << metric << " history for " << test_name << std::endl;
+        return 1;
+    }
+
+    size_t runs = 0;
+    for (const CommitValues& commit : series) runs += commit.values.size();
+    std::cout << "Trend of " << test_name << " " << metric << " (" << series.size() << " commits, "
+              << runs << " runs)" << std::endl;
+    std::cout << std::left << std::setw(14) << "Commit" << std::setw(6) << "Runs" << std::setw(16) << "Median"
+              << std::setw(10) << "Change" << "vs first" << std::endl;
+    const double first = median_of(series.front().values);
+    double previous = first;
+    for (size_t k = 0; k < series.size(); ++k) {
+        double median = median_of(series[k].values);
+        std::cout << std::left << std::setw(14) << series[k].commit << std::setw(6) << series[k].values.size()
+                  << std::setw(16) << format_value(metric, median)
+                  << std::setw(10) << (k == 0 ? "" : format_change(previous, median))
+                  << (k == 0 ? "" : format_change(first, median)) << std::endl;
+        previous = median;
+    }
+
+    Shift shift = find_shift(series);
+    if (significant(shift, options)) {
+        std::cout << "Moved at " << series[shift.at].commit << ": " << format_value(metric, shift.before) << " -> "
+                  << format_value(metric, shift.after) << " (" << format_change(shift.before, shift.after)
+                  << ", p = " << std::setprecision(2) << shift.pValue << ")" << std::endl;
+    } else {
+        std::cout << "No significant move (alpha " << options.alpha << ", at least " << options.minChange
+                  << "%)" << std::endl;
+    }
+    return 0;
+}
+
+// Every series with a significant move, largest relative change first
+int scan(const perf_history::Store& store, const std::string& metric_filter, const QueryOptions& options) {
+    std::map<std::pair<uint32_t, uint32_t>, bool> keys;
+    for (const perf_history::Sample& sample : store.samples) {
+        keys[std::make_pair(sample.test, sample.metric)] = true;
+    }
+    struct Move {
+        std::string test;
+        std::string metric;
+        std::string commit;
+        Shift shift;
+    };
+    std::vector<Move> moves;
+    for (const auto& key : keys) {
+        const std::string& metric = store.name(key.first.second);
+        if (!metric_filter.empty() && metric != metric_filter) continue;
+        std::vector<CommitValues> series = series_of(store, key.first.first, key.first.second);
+        Shift shift = find_shift(series);
+        if (!significant(shift, options)) continue;
+        Move move = { store.name(key.first.first), metric, series[shift.at].commit, shift };
+        moves.push_back(move);
+    }
+    std::sort(moves.begin(), moves.end(), [](const Move& a, const Move& b) {
+        return relative_change(a.shift) > relative_change(b.shift);
+    });
+    if (moves.empty()) {
+        std::cout << "No significant moves (alpha " << options.alpha << ", at least " << options.minChange << "%)"
+                  << std::endl;
+        return 0;
+    }
+    for (const Move& move : moves) {
+        std::cout << std::left << std::setw(10) << format_change(move.shift.before, move.shift.after)
+                  << std::setw(14) << move.commit << move.test << " " << move.metric << " ("
+                  << format_value(move.metric, move.shift.before) << " -> "
+                  << format_value(move.metric, move.shift.after) << ")" << std::endl;
+    }
+    return 0;
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " STORE COMMAND [options]" << std::endl;
+    std::cout << "  tests                   List recorded tests and metrics with their record counts" << std::endl;
+    std::cout << "  trend TEST [METRIC]     Per-commit median of a metric and the commit where it moved" << std::endl;
+    std::cout << "                          (default metric: bench_median_ns for benchmarks, else duration_ns)" << std::endl;
+    std::cout << "  scan [METRIC]           Every test whose metric moved significantly, largest move first" << std::endl;
+    std::cout << "  --alpha P               Significance level of a move (default 0.01)" << std::endl;
+    std::cout << "  --min-change PCT        Smallest move reported, in percent (default 5)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QueryOptions options;
+    std::vector<std::string> words;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--alpha" || arg == "--min-change") && i + 1 < argc) {
+            char* end = nullptr;
+            double value = std::strtod(argv[++i], &end);
+            if (*end != '\0' || value <= 0) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                return 2;
+            }
+            (arg == "--alpha" ? options.alpha : options.minChange) = value;
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            words.push_back(arg);
+        }
+    }
+    if (words.size() < 2) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    perf_history::Store store;
+    if (!store.read(words[0])) {
+        std::cerr << "Cannot read performance history " << words[0] << std::endl;
+        return 1;
+    }
+    const std::string& command = words[1];
+    if (command == "tests" && words.size() == 2) return list_tests(store);
+    if (command == "trend" && (words.size() == 3 || words.size() == 4)) {
+        return print_trend(store, words[2], words.size() == 4 ? words[3] : std::string(), options);
+    }
+    if (command == "scan" && words.size() <= 3) return scan(store, words.size() == 3 ? words[2] : std::string(), options);
+    print_usage(argv[0]);
+    return 2;
+}
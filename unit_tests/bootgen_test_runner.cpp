@@ -0,0 +1,704 @@
+/******************************************************************************
+* Copyright 2015-2022 Xilinx, Inc.
+* Copyright 2022-2023 Advanced Micro Devices, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+******************************************************************************/
+
+// Runs every test suite binary exactly once, several at a time, and writes
+// SUMMARY_REPORT.txt from that single pass. Each suite runs inside the
+// reports directory (so its *_report.txt lands there), its output goes to
+// <suite>.log, and its results are read back from the JSON Lines report it
+// streams, instead of scraping the text reports.
+//
+// Results are cached per suite under a hash of the suite binary, the options
+// passed to it and the BOOTGEN_TEST_* environment. When none of those changed
+// since the last run the suite is not run again; its log, JSON Lines and text
+// report are restored from the cache instead. --no-cache forces a full run.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace {
+
+struct RunnerOptions {
+    std::string buildDir = "../build";
+    std::string reportsDir = "test_reports";
+    unsigned jobs = 0;                  // 0 = one suite per hardware thread
+    std::string cacheDir;               // Default: <reports>/.cache
+    std::vector<std::string> only;      // Non-empty: run just these suites
+    bool useCache = true;
+    std::vector<std::string> suiteArgs; // Everything after "--", passed to every suite
+    std::string shardTag;               // "_shard<I>of<N>" when the suites run one shard
+};
+
+struct SuiteRun {
+    std::string name;                   // Binary name, e.g. test_basic_functionality
+    std::string path;
+    int exitCode = -1;
+    int signal = 0;
+    bool started = false;
+    bool cached = false;                // Results restored from the cache, not run
+    double seconds = 0.0;
+    // From the suite's JSON Lines report
+    bool hasResults = false;            // The report exists
+    bool complete = false;              // The summary record was written
+    long tests = 0;
+    long failedTests = 0;
+    long assertionsPassed = 0;
+    long assertionsFailed = 0;
+
+    bool passed() const { return started && signal == 0 && exitCode == 0 && hasResults; }
+};
+
+struct Colors {
+    const char* red = "";
+    const char* green = "";
+    const char* yellow = "";
+    const char* blue = "";
+    const char* cyan = "";
+    const char* reset = "";
+};
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options] [-- suite options]" << std::endl;
+    std::cout << "  --build-dir DIR    Directory holding the test_* binaries (default ../build)" << std::endl;
+    std::cout << "  --reports DIR      Where logs and reports are written (default test_reports)" << std::endl;
+    std::cout << "  -j N, --jobs N     Suites run at once (default: hardware threads)" << std::endl;
+    std::cout << "  --cache-dir DIR    Where suite results are cached (default <reports>/.cache)" << std::endl;
+    std::cout << "  --no-cache         Run every suite even if a cached result matches" << std::endl;
+    std::cout << "  --only=A,B         Run only the named suites (e.g. test_argument_parsing)" << std::endl;
+    std::cout << "  -h, --help         Show this help message" << std::endl;
+    std::cout << "Options after -- are passed to every suite, e.g. -- --filter='*Parse*'" << std::endl;
+}
+
+// Last value of a suite option given as "--name value" or "--name=value"
+bool suite_option(const std::vector<std::string>& args, const char* name, std::string& value) {
+    const std::string prefix = std::string(name) + "=";
+    bool found = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i].compare(0, prefix.size(), prefix) == 0) {
+            value = args[i].substr(prefix.size());
+            found = true;
+        } else if (args[i] == name && i + 1 < args.size()) {
+            value = args[++i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Sharded suites add the shard to their report names (shard_report_filename
+// in the framework), so the runner has to look for the same names. Options
+// override the BOOTGEN_TEST_SHARD_* variables, as in the suites.
+std::string shard_tag(const std::vector<std::string>& suiteArgs) {
+    std::string index = "0", count = "1";
+    if (const char* value = std::getenv("BOOTGEN_TEST_SHARD_INDEX")) index = value;
+    if (const char* value = std::getenv("BOOTGEN_TEST_SHARD_COUNT")) count = value;
+    suite_option(suiteArgs, "--shard-index", index);
+    suite_option(suiteArgs, "--shard-count", count);
+    unsigned long shards = std::strtoul(count.c_str(), nullptr, 10);
+    if (shards <= 1) return "";
+    std::ostringstream tag;
+    tag << "_shard" << std::strtoul(index.c_str(), nullptr, 10) << "of" << shards;
+    return tag.str();
+}
+
+bool parse_options(int argc, char* argv[], RunnerOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value;
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        bool takes_value = name == "--build-dir" || name == "--reports" || name == "--jobs" || name == "-j" ||
+                           name == "--cache-dir" || name == "--only";
+        if (takes_value) {
+            if (equals != std::string::npos) {
+                value = arg.substr(equals + 1);
+            } else if (i + 1 < argc) {
+                value = argv[++i];
+            } else {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return false;
+            }
+        }
+
+        if (arg == "--") {
+            options.suiteArgs.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (name == "--build-dir") {
+            options.buildDir = value;
+        } else if (name == "--reports") {
+            options.reportsDir = value;
+        } else if (name == "--cache-dir") {
+            options.cacheDir = value;
+        } else if (arg == "--no-cache") {
+            options.useCache = false;
+        } else if (name == "--only") {
+            std::istringstream list(value);
+            std::string suite;
+            while (std::getline(list, suite, ',')) {
+                if (!suite.empty()) options.only.push_back(suite);
+            }
+        } else if (name == "--jobs" || name == "-j") {
+            char* end = nullptr;
+            unsigned long jobs = std::strtoul(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0') {
+                std::cerr << "Invalid value for " << name << ": " << value << std::endl;
+                return false;
+            }
+            options.jobs = static_cast<unsigned>(jobs);
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            std::exit(0);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    if (options.cacheDir.empty()) options.cacheDir = options.reportsDir + "/.cache";
+    options.shardTag = shard_tag(options.suiteArgs);
+    return true;
+}
+
+// The JSON Lines report a suite writes, relative to the reports directory
+std::string jsonl_name(const SuiteRun& suite, const RunnerOptions& options) {
+    return suite.name + options.shardTag + ".jsonl";
+}
+
+// Reads an integer field from one flat JSON object line
+bool json_integer(const std::string& line, const char* key, long& value) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t at = line.find(pattern);
+    if (at == std::string::npos) return false;
+    value = std::strtol(line.c_str() + at + pattern.size(), nullptr, 10);
+    return true;
+}
+
+// Totals from the summary record; a suite that died before writing it is
+// counted from the test records it did write
+void read_results(const std::string& jsonlPath, SuiteRun& suite) {
+    std::ifstream in(jsonlPath.c_str());
+    if (!in) return;
+    suite.hasResults = true;
+    std::string line;
+    long passed = 0, failed = 0, tests = 0, failedTests = 0;
+    while (std::getline(in, line)) {
+        long value = 0;
+        if (line.find("\"type\":\"summary\"") != std::string::npos) {
+            suite.complete = true;
+            json_integer(line, "tests", suite.tests);
+            json_integer(line, "failed_tests", suite.failedTests);
+            json_integer(line, "assertions_passed", suite.assertionsPassed);
+            json_integer(line, "assertions_failed", suite.assertionsFailed);
+            return;
+        }
+        if (line.find("\"type\":\"test\"") == std::string::npos) continue;
+        tests++;
+        if (line.find("\"status\":\"PASSED\"") == std::string::npos) failedTests++;
+        if (json_integer(line, "assertions_passed", value)) passed += value;
+        if (json_integer(line, "assertions_failed", value)) failed += value;
+    }
+    suite.tests = tests;
+    suite.failedTests = failedTests;
+    suite.assertionsPassed = passed;
+    suite.assertionsFailed = failed;
+}
+
+std::string format_rate(long part, long whole) {
+    std::ostringstream rate;
+    rate << std::fixed << std::setprecision(1) << (whole > 0 ? 100.0 * part / whole : 0.0);
+    return rate.str();
+}
+
+#ifndef _WIN32
+
+std::string suite_status(const SuiteRun& suite) {
+    if (!suite.started) return "NOT RUN";
+    if (suite.signal != 0) return "CRASHED (" + std::string(strsignal(suite.signal)) + ")";
+    if (suite.exitCode == 0 && !suite.hasResults) return "FAILED (no JSON Lines report)";
+    return suite.passed() ? "PASSED" : "FAILED";
+}
+
+std::vector<SuiteRun> discover_suites(const std::string& buildDir) {
+    std::vector<SuiteRun> suites;
+    DIR* dir = ::opendir(buildDir.c_str());
+    if (!dir) return suites;
+    while (struct dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.compare(0, 5, "test_") != 0) continue;
+        std::string path = buildDir + "/" + name;
+        struct stat info;
+        if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode) || ::access(path.c_str(), X_OK) != 0) continue;
+        char resolved[PATH_MAX];
+        SuiteRun suite;
+        suite.name = name;
+        suite.path = ::realpath(path.c_str(), resolved) ? resolved : path;
+        suites.push_back(suite);
+    }
+    ::closedir(dir);
+    std::sort(suites.begin(), suites.end(), [](const SuiteRun& a, const SuiteRun& b) { return a.name < b.name; });
+    return suites;
+}
+
+// Starts one suite in the reports directory with its output sent to <suite>.log
+pid_t start_suite(const SuiteRun& suite, const RunnerOptions& options) {
+    std::vector<std::string> args;
+    args.push_back(suite.path);
+    args.push_back("--report-jsonl=" + suite.name + ".jsonl");     // Sharded suites add shardTag
+    args.insert(args.end(), options.suiteArgs.begin(), options.suiteArgs.end());
+    std::vector<char*> argv;
+    for (auto& arg : args) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+    std::string log = suite.name + ".log";
+
+    std::cout.flush();
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        int fd = -1;
+        if (::chdir(options.reportsDir.c_str()) == 0) {
+            fd = ::open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        if (fd < 0) _exit(127);
+        ::dup2(fd, STDOUT_FILENO);
+        ::dup2(fd, STDERR_FILENO);
+        ::close(fd);
+        ::execv(argv[0], argv.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+void print_log(const std::string& path) {
+    std::ifstream log(path.c_str());
+    // Streaming an empty buffer would set failbit and silence std::cout
+    if (log.peek() != std::ifstream::traits_type::eof()) std::cout << log.rdbuf();
+    std::cout.flush();
+}
+
+// 64-bit FNV-1a; enough to notice a changed binary, not meant to resist tampering
+const uint64_t kHashSeed = 14695981039346656037ull;
+
+uint64_t hash_bytes(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t hash_string(uint64_t hash, const std::string& text) {
+    // The terminator keeps ("ab", "c") and ("a", "bc") apart
+    return hash_bytes(hash, text.c_str(), text.size() + 1);
+}
+
+bool hash_file(const std::string& path, uint64_t& hash) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) return false;
+    char buffer[65536];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+        hash = hash_bytes(hash, buffer, static_cast<size_t>(in.gcount()));
+    }
+    return true;
+}
+
+// Suite options and variables that name a file the suite reads
+const char* const kInputFileOptions[] = { "--bench-baseline", "--quarantine", "--durations-file" };
+const char* const kInputFileVariables[] = { "BOOTGEN_TEST_QUARANTINE", "BOOTGEN_TEST_DURATIONS" };
+
+// Paths of the files the suite options and variables point the suites at.
+// Relative paths are resolved against the reports directory, where suites run.
+std::vector<std::string> input_files(const RunnerOptions& options) {
+    std::vector<std::string> paths;
+    const std::vector<std::string>& args = options.suiteArgs;
+    for (size_t i = 0; i < args.size(); ++i) {
+        for (const char* option : kInputFileOptions) {
+            const std::string prefix = std::string(option) + "=";
+            if (args[i].compare(0, prefix.size(), prefix) == 0) {
+                paths.push_back(args[i].substr(prefix.size()));
+            } else if (args[i] == option && i + 1 < args.size()) {
+                paths.push_back(args[i + 1]);
+            }
+        }
+    }
+    for (const char* variable : kInputFileVariables) {
+        const char* value = std::getenv(variable);
+        if (value && *value) paths.push_back(value);
+    }
+    for (auto& path : paths) {
+        if (path[0] != '/') path = options.reportsDir + "/" + path;
+    }
+    return paths;
+}
+
+// Everything that can change a suite's results: its binary, its options, the
+// BOOTGEN_TEST_* variables the framework reads and the files they name
+std::string cache_key(const SuiteRun& suite, const RunnerOptions& options) {
+    uint64_t hash = hash_string(kHashSeed, "bootgen-test-cache-2");
+    if (!hash_file(suite.path, hash)) return "";
+    for (const auto& arg : options.suiteArgs) {
+        hash = hash_string(hash, arg);
+    }
+    std::vector<std::string> variables;
+    for (char** entry = environ; entry && *entry; ++entry) {
+        if (std::strncmp(*entry, "BOOTGEN_TEST_", 13) == 0) variables.push_back(*entry);
+    }
+    std::sort(variables.begin(), variables.end());
+    for (const auto& variable : variables) {
+        hash = hash_string(hash, variable);
+    }
+    // A missing file hashes differently from an empty one
+    for (const auto& path : input_files(options)) {
+        hash = hash_string(hash, path);
+        if (!hash_file(path, hash)) hash = hash_string(hash, "<missing>");
+    }
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+bool copy_file(const std::string& from, const std::string& to) {
+    std::ifstream in(from.c_str(), std::ios::binary);
+    if (!in) return false;
+    std::ofstream out(to.c_str(), std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+    return static_cast<bool>(out);
+}
+
+// The text report a suite wrote, as announced in its output
+std::string report_written_by(const std::string& logPath) {
+    const std::string marker = "Test report generated: ";
+    std::ifstream log(logPath.c_str());
+    std::string line, report;
+    while (std::getline(log, line)) {
+        if (line.compare(0, marker.size(), marker) == 0) report = line.substr(marker.size());
+    }
+    return report;
+}
+
+// One entry per suite, <cache>/<suite>/: "result" holds the key and exit
+// status, next to copies of the files the run produced
+bool restore_cached(SuiteRun& suite, const std::string& key, const RunnerOptions& options) {
+    const std::string entry = options.cacheDir + "/" + suite.name + "/";
+    std::ifstream result((entry + "result").c_str());
+    std::string cachedKey, report;
+    int exitCode = -1;
+    double seconds = 0.0;
+    if (!(result >> cachedKey >> exitCode >> seconds) || cachedKey != key) return false;
+    std::getline(result >> std::ws, report);
+
+    const std::string target = options.reportsDir + "/";
+    if (!copy_file(entry + "log", target + suite.name + ".log") ||
+        !copy_file(entry + "jsonl", target + jsonl_name(suite, options))) {
+        return false;
+    }
+    if (!report.empty() && report.find('/') == std::string::npos) {
+        copy_file(entry + "report", target + report);
+    }
+    suite.started = true;
+    suite.cached = true;
+    suite.exitCode = exitCode;
+    suite.seconds = seconds;
+    return true;
+}
+
+// Only suites that passed are cached: a failure may be flaky or the machine's
+// fault, and replaying it would hide the next real result until a rebuild
+void store_cached(const SuiteRun& suite, const std::string& key, const RunnerOptions& options) {
+    if (key.empty() || suite.signal != 0 || suite.exitCode != 0 || !suite.complete) return;
+    const std::string entry = options.cacheDir + "/" + suite.name + "/";
+    ::mkdir(options.cacheDir.c_str(), 0755);
+    ::mkdir(entry.c_str(), 0755);
+    ::unlink((entry + "result").c_str());
+
+    const std::string source = options.reportsDir + "/";
+    std::string report = report_written_by(source + suite.name + ".log");
+    if (!copy_file(source + suite.name + ".log", entry + "log") ||
+        !copy_file(source + jsonl_name(suite, options), entry + "jsonl") ||
+        (!report.empty() && !copy_file(source + report, entry + "report"))) {
+        return;
+    }
+    // Written last, so an interrupted store is never mistaken for a valid entry
+    std::ofstream result((entry + "result").c_str());
+    result << key << ' ' << suite.exitCode << ' ' << suite.seconds << '\n' << report << '\n';
+}
+
+// Whole logs in completion order, so parallel suites never interleave
+void print_finished(SuiteRun& suite, const RunnerOptions& options, const Colors& colors) {
+    read_results(options.reportsDir + "/" + jsonl_name(suite, options), suite);
+    std::cout << "=======================================" << std::endl;
+    std::cout << colors.blue << "Finished: " << suite.name << (suite.cached ? " (cached)" : "") << colors.reset << std::endl;
+    std::cout << "=======================================" << std::endl;
+    print_log(options.reportsDir + "/" + suite.name + ".log");
+    std::cout << (suite.passed() ? colors.green : colors.red) << (suite.passed() ? "✓ " : "✗ ")
+              << suite.name << " " << suite_status(suite);
+    if (suite.cached) {
+        std::cout << " (cached result, unchanged binary and inputs)";
+    } else {
+        std::cout << " in " << std::fixed << std::setprecision(2) << suite.seconds << " s";
+    }
+    std::cout << colors.reset << std::endl << std::endl;
+}
+
+// Suites that append to a --history-store must really run: a result restored
+// from the cache would leave that run out of the history
+bool records_history(const RunnerOptions& options) {
+    for (const auto& arg : options.suiteArgs) {
+        if (arg == "--history-store" || arg.compare(0, 16, "--history-store=") == 0) return true;
+    }
+    const char* store = std::getenv("BOOTGEN_TEST_HISTORY_STORE");
+    return store && *store;
+}
+
+void run_suites(std::vector<SuiteRun>& suites, const RunnerOptions& options, const Colors& colors) {
+    const bool use_cache = options.useCache && !records_history(options);
+    if (options.useCache && !use_cache) {
+        std::cout << "Recording performance history; cached results are not used" << std::endl << std::endl;
+    }
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::pair<pid_t, size_t> > running;
+    std::vector<std::chrono::steady_clock::time_point> started(suites.size());
+    std::vector<std::string> keys(suites.size());
+    size_t next = 0;
+
+    while (next < suites.size() || !running.empty()) {
+        while (next < suites.size() && running.size() < jobs) {
+            keys[next] = cache_key(suites[next], options);
+            if (use_cache && !keys[next].empty() && restore_cached(suites[next], keys[next], options)) {
+                print_finished(suites[next], options, colors);
+                next++;
+                continue;
+            }
+            pid_t pid = start_suite(suites[next], options);
+            if (pid > 0) {
+                suites[next].started = true;
+                started[next] = std::chrono::steady_clock::now();
+                running.push_back(std::make_pair(pid, next));
+            } else {
+                std::cerr << "Could not start " << suites[next].name << ": " << std::strerror(errno) << std::endl;
+            }
+            next++;
+        }
+        if (running.empty()) continue;
+
+        int status = 0;
+        pid_t pid = ::waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        auto it = std::find_if(running.begin(), running.end(),
+                               [pid](const std::pair<pid_t, size_t>& entry) { return entry.first == pid; });
+        if (it == running.end()) continue;
+        SuiteRun& suite = suites[it->second];
+        suite.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started[it->second]).count();
+        if (WIFSIGNALED(status)) {
+            suite.signal = WTERMSIG(status);
+        } else if (WIFEXITED(status)) {
+            suite.exitCode = WEXITSTATUS(status);
+        }
+        size_t index = it->second;
+        running.erase(it);
+
+        print_finished(suite, options, colors);
+        store_cached(suite, keys[index], options);
+    }
+}
+
+std::vector<std::string> report_files(const std::string& reportsDir) {
+    std::vector<std::string> files;
+    const std::string suffix = "_report.txt";
+    if (DIR* dir = ::opendir(reportsDir.c_str())) {
+        while (struct dirent* entry = ::readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                files.push_back(name);
+            }
+        }
+        ::closedir(dir);
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+#endif // _WIN32
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    (void)argc;
+    (void)argv;
+    std::cerr << "bootgen_test_runner needs a POSIX system; use unit_tests/run_tests.ps1 on Windows" << std::endl;
+    return 2;
+#else
+    RunnerOptions options;
+    if (!parse_options(argc, argv, options)) return 2;
+
+    Colors colors;
+    if (::isatty(STDOUT_FILENO)) {
+        colors.red = "\033[0;31m";
+        colors.green = "\033[0;32m";
+        colors.yellow = "\033[1;33m";
+        colors.blue = "\033[0;34m";
+        colors.cyan = "\033[0;36m";
+        colors.reset = "\033[0m";
+    }
+
+    std::cout << "=======================================" << std::endl;
+    std::cout << "BOOTGEN UNIT TEST RUNNER" << std::endl;
+    std::cout << "=======================================" << std::endl << std::endl;
+
+    std::vector<SuiteRun> suites = discover_suites(options.buildDir);
+    if (!options.only.empty()) {
+        for (const auto& name : options.only) {
+            if (std::none_of(suites.begin(), suites.end(), [&name](const SuiteRun& suite) { return suite.name == name; })) {
+                std::cerr << "No test executable named " << name << " in " << options.buildDir << std::endl;
+                return 2;
+            }
+        }
+        suites.erase(std::remove_if(suites.begin(), suites.end(), [&options](const SuiteRun& suite) {
+            return std::find(options.only.begin(), options.only.end(), suite.name) == options.only.end();
+        }), suites.end());
+    }
+    if (suites.empty()) {
+        std::cout << "No test executables found in " << options.buildDir
+                  << ". Please run 'make unit-tests' first." << std::endl;
+        return 1;
+    }
+    std::cout << "Found " << suites.size() << " test executable(s):" << std::endl;
+    for (const auto& suite : suites) {
+        std::cout << "  " << suite.name << std::endl;
+    }
+    std::cout << std::endl;
+
+    ::mkdir(options.reportsDir.c_str(), 0755);
+    auto start = std::chrono::steady_clock::now();
+    run_suites(suites, options, colors);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long passed_suites = 0, failed_suites = 0;
+    long total_assertions = 0, passed_assertions = 0, failed_assertions = 0;
+    long cached_suites = 0;
+    double suite_seconds = 0.0;
+    for (const auto& suite : suites) {
+        (suite.passed() ? passed_suites : failed_suites)++;
+        passed_assertions += suite.assertionsPassed;
+        failed_assertions += suite.assertionsFailed;
+        if (suite.cached) {
+            cached_suites++;
+        } else {
+            suite_seconds += suite.seconds;
+        }
+    }
+    total_assertions = passed_assertions + failed_assertions;
+    const long total_suites = static_cast<long>(suites.size());
+
+    std::string summary_file = options.reportsDir + "/SUMMARY_REPORT.txt";
+    std::ofstream summary(summary_file.c_str());
+    std::time_t now = std::time(nullptr);
+    summary << "======================================" << std::endl;
+    summary << "BOOTGEN UNIT TESTS - SUMMARY REPORT" << std::endl;
+    summary << "======================================" << std::endl;
+    summary << "Generated: " << std::ctime(&now) << std::endl;
+    summary << "OVERALL RESULTS:" << std::endl;
+    summary << "===============" << std::endl;
+    summary << "Total Test Suites: " << total_suites << std::endl;
+    summary << "Passed: " << passed_suites << std::endl;
+    summary << "Failed: " << failed_suites << std::endl;
+    summary << "Success Rate: " << format_rate(passed_suites, total_suites) << "%" << std::endl;
+    summary << std::fixed << std::setprecision(2);
+    summary << "Wall Time: " << wall << " s (" << suite_seconds << " s of suite time)" << std::endl;
+    summary << "Cached Suites: " << cached_suites << std::endl << std::endl;
+    summary << "DETAILED TEST RESULTS:" << std::endl;
+    summary << "=====================" << std::endl;
+    summary << "Total Individual Tests: " << total_assertions << std::endl;
+    summary << "Individual Tests Passed: " << passed_assertions << std::endl;
+    summary << "Individual Tests Failed: " << failed_assertions << std::endl;
+    summary << "Individual Success Rate: " << format_rate(passed_assertions, total_assertions) << "%" << std::endl << std::endl;
+    summary << "TEST SUITE DETAILS:" << std::endl;
+    summary << "==================" << std::endl;
+    for (const auto& suite : suites) {
+        summary << suite.name << ": " << suite_status(suite) << " (" << suite.tests << " tests, "
+                << suite.failedTests << " failed, ";
+        if (suite.cached) {
+            summary << "cached";
+        } else {
+            summary << suite.seconds << " s";
+        }
+        if (suite.started && !suite.complete) summary << ", results incomplete";
+        summary << ")" << std::endl;
+    }
+    summary << std::endl << "INDIVIDUAL REPORTS:" << std::endl;
+    summary << "==================" << std::endl;
+    for (const auto& file : report_files(options.reportsDir)) {
+        summary << "- " << file << std::endl;
+    }
+    summary.close();
+
+    std::cout << "=======================================" << std::endl;
+    std::cout << "FINAL SUMMARY" << std::endl;
+    std::cout << "=======================================" << std::endl;
+    std::cout << "Total Test Suites: " << total_suites << std::endl;
+    std::cout << "Passed: " << colors.green << passed_suites << colors.reset << std::endl;
+    std::cout << "Failed: " << colors.red << failed_suites << colors.reset << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << "Wall Time: " << wall << " s";
+    if (cached_suites > 0) std::cout << " (" << cached_suites << " suite(s) from cache; --no-cache to rerun)";
+    std::cout << std::endl << std::endl;
+    std::cout << "INDIVIDUAL TEST DETAILS:" << std::endl;
+    std::cout << "========================" << std::endl;
+    std::cout << "Total Individual Tests: " << colors.blue << total_assertions << colors.reset << std::endl;
+    std::cout << "Individual Tests Passed: " << colors.green << passed_assertions << colors.reset << std::endl;
+    std::cout << "Individual Tests Failed: " << colors.red << failed_assertions << colors.reset << std::endl;
+    std::cout << "Individual Success Rate: " << colors.cyan << format_rate(passed_assertions, total_assertions)
+              << "%" << colors.reset << std::endl << std::endl;
+
+    if (failed_suites == 0) {
+        std::cout << colors.green << "🎉 All test suites passed!" << colors.reset << std::endl;
+    } else {
+        std::cout << colors.red << "❌ Some test suites failed." << colors.reset << std::endl;
+        std::cout << colors.yellow << "Check individual reports in " << options.reportsDir << "/ directory"
+                  << colors.reset << std::endl;
+    }
+    std::cout << std::endl << "Reports available in: " << options.reportsDir << "/" << std::endl;
+    std::cout << "Summary report: " << summary_file << std::endl;
+    std::cout << "=======================================" << std::endl;
+    return failed_suites == 0 ? 0 : 1;
+#endif
+}
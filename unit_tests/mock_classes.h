@@ -24,6 +24,7 @@
 #include <memory>
 #include <cstring>  // For memset, strcmp, strlen, strcpy
 #include <cstdio>   // For printf
+#include "test_framework.h"  // For TRACE_SCOPE
 
 // Mock Options class for testing
 class MockOptions {
@@ -39,6 +40,7 @@ public:
     std::vector<std::string> arguments;
 
     void ParseArgs(int argc, const char* argv[]) {
+        TRACE_SCOPE("MockOptions::ParseArgs");
         parseArgsCalled = true;
         arguments.clear();
         
@@ -137,6 +139,7 @@ public:
     }
 
     void Process(MockOptions& options) {
+        TRACE_SCOPE("MockBIF_File::Process");
         processCalled = true;
         
         if (!isValid) {
@@ -165,11 +168,13 @@ public:
     bool displayBannerCalled = false;
 
     void DisplayBanner() {
+        TRACE_SCOPE("TestableBootGenApp::DisplayBanner");
         displayBannerCalled = true;
         // Simulate banner display
     }
 
     void Run(int argc, const char* argv[]) {
+        TRACE_SCOPE("TestableBootGenApp::Run");
         DisplayBanner();
         
         MockOptions options;
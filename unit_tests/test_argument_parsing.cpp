@@ -18,7 +18,7 @@
 #include "test_framework.h"
 #include "mock_classes.h"
 
-void test_ParseArgs_NoArguments() {
+TEST(ArgumentParsing, ParseArgs_NoArguments) {
     MockOptions options;
     const char* argv[] = {"bootgen"};
     int argc = 1;
@@ -28,11 +28,11 @@ void test_ParseArgs_NoArguments() {
     });
     
     EXPECT_TRUE(options.parseArgsCalled);
-    EXPECT_EQ(1, options.arguments.size());
+    EXPECT_EQ(1u, options.arguments.size());
     EXPECT_STREQ("bootgen", options.arguments[0].c_str());
 }
 
-void test_ParseArgs_ImageArgument() {
+TEST(ArgumentParsing, ParseArgs_ImageArgument) {
     MockOptions options;
     const char* argv[] = {"bootgen", "-image", "test.bif"};
     int argc = 3;
@@ -43,10 +43,10 @@ void test_ParseArgs_ImageArgument() {
     
     EXPECT_TRUE(options.parseArgsCalled);
     EXPECT_STREQ("test.bif", options.GetBifFilename().c_str());
-    EXPECT_EQ(3, options.arguments.size());
+    EXPECT_EQ(3u, options.arguments.size());
 }
 
-void test_ParseArgs_OutputArgument() {
+TEST(ArgumentParsing, ParseArgs_OutputArgument) {
     MockOptions options;
     const char* argv[] = {"bootgen", "-image", "test.bif", "-o", "output.bin"};
     int argc = 5;
@@ -60,7 +60,7 @@ void test_ParseArgs_OutputArgument() {
     EXPECT_STREQ("output.bin", options.GetOutputFilename().c_str());
 }
 
-void test_ParseArgs_ArchitectureArgument() {
+TEST(ArgumentParsing, ParseArgs_ArchitectureArgument) {
     MockOptions options;
     const char* argv[] = {"bootgen", "-arch", "zynq", "-image", "test.bif"};
     int argc = 5;
@@ -74,7 +74,7 @@ void test_ParseArgs_ArchitectureArgument() {
     EXPECT_STREQ("test.bif", options.GetBifFilename().c_str());
 }
 
-void test_ParseArgs_HelpArgument() {
+TEST(ArgumentParsing, ParseArgs_HelpArgument) {
     MockOptions options;
     const char* argv[] = {"bootgen", "-help"};
     int argc = 2;
@@ -87,7 +87,7 @@ void test_ParseArgs_HelpArgument() {
     EXPECT_TRUE(options.IsHelpRequested());
 }
 
-void test_ParseArgs_VerboseArgument() {
+TEST(ArgumentParsing, ParseArgs_VerboseArgument) {
     MockOptions options;
     const char* argv[] = {"bootgen", "-verbose", "-image", "test.bif"};
     int argc = 4;
@@ -101,7 +101,7 @@ void test_ParseArgs_VerboseArgument() {
     EXPECT_STREQ("test.bif", options.GetBifFilename().c_str());
 }
 
-void test_ParseArgs_AllArguments() {
+TEST(ArgumentParsing, ParseArgs_AllArguments) {
     MockOptions options;
     const char* argv[] = {"bootgen", "-arch", "versal", "-image", "complex.bif", "-o", "final.bin", "-verbose"};
     int argc = 8;
@@ -115,10 +115,10 @@ void test_ParseArgs_AllArguments() {
     EXPECT_STREQ("complex.bif", options.GetBifFilename().c_str());
     EXPECT_STREQ("final.bin", options.GetOutputFilename().c_str());
     EXPECT_TRUE(options.IsVerboseMode());
-    EXPECT_EQ(8, options.arguments.size());
+    EXPECT_EQ(8u, options.arguments.size());
 }
 
-void test_ParseArgs_Reset() {
+TEST(ArgumentParsing, ParseArgs_Reset) {
     MockOptions options;
     const char* argv[] = {"bootgen", "-image", "test.bif", "-verbose"};
     int argc = 4;
@@ -133,7 +133,7 @@ void test_ParseArgs_Reset() {
     EXPECT_TRUE(options.GetBifFilename().empty());
 }
 
-void test_ProcessMethods() {
+TEST(ArgumentParsing, ProcessMethods) {
     MockOptions options;
     
     EXPECT_FALSE(options.processVerifyKDFCalled);
@@ -146,22 +146,4 @@ void test_ProcessMethods() {
     EXPECT_TRUE(options.processReadImageCalled);
 }
 
-int main() {
-    std::cout << "Running Argument Parsing Tests..." << std::endl;
-    std::cout << "=================================" << std::endl;
-
-    RUN_TEST(test_ParseArgs_NoArguments);
-    RUN_TEST(test_ParseArgs_ImageArgument);
-    RUN_TEST(test_ParseArgs_OutputArgument);
-    RUN_TEST(test_ParseArgs_ArchitectureArgument);
-    RUN_TEST(test_ParseArgs_HelpArgument);
-    RUN_TEST(test_ParseArgs_VerboseArgument);
-    RUN_TEST(test_ParseArgs_AllArguments);
-    RUN_TEST(test_ParseArgs_Reset);
-    RUN_TEST(test_ProcessMethods);
-
-    print_test_summary();
-    generate_test_report("argument_parsing_report.txt");
-    
-    return get_exit_code();
-}
+TEST_SUITE(argument_parsing, "Argument Parsing Tests", "argument_parsing_report.txt");
@@ -18,7 +18,7 @@
 #include "test_framework.h"
 #include "mock_classes.h"
 
-void test_BootGenApp_RunWithValidBifFile() {
+TEST(BasicFunctionality, BootGenApp_RunWithValidBifFile) {
     TestableBootGenApp app;
     const char* argv[] = {"bootgen", "-image", "test.bif", "-o", "output.bin"};
     int argc = 5;
@@ -30,7 +30,7 @@ void test_BootGenApp_RunWithValidBifFile() {
     EXPECT_TRUE(app.WasDisplayBannerCalled());
 }
 
-void test_BootGenApp_RunWithEmptyBifFile() {
+TEST(BasicFunctionality, BootGenApp_RunWithEmptyBifFile) {
     TestableBootGenApp app;
     const char* argv[] = {"bootgen"};
     int argc = 1;
@@ -42,7 +42,7 @@ void test_BootGenApp_RunWithEmptyBifFile() {
     EXPECT_TRUE(app.WasDisplayBannerCalled());
 }
 
-void test_BootGenApp_RunWithHelpArgument() {
+TEST(BasicFunctionality, BootGenApp_RunWithHelpArgument) {
     TestableBootGenApp app;
     const char* argv[] = {"bootgen", "-help"};
     int argc = 2;
@@ -54,7 +54,7 @@ void test_BootGenApp_RunWithHelpArgument() {
     EXPECT_TRUE(app.WasDisplayBannerCalled());
 }
 
-void test_BootGenApp_RunWithMultipleArguments() {
+TEST(BasicFunctionality, BootGenApp_RunWithMultipleArguments) {
     TestableBootGenApp app;
     const char* argv[] = {"bootgen", "-arch", "zynq", "-image", "test.bif", "-o", "output.bin", "-verbose"};
     int argc = 8;
@@ -66,7 +66,7 @@ void test_BootGenApp_RunWithMultipleArguments() {
     EXPECT_TRUE(app.WasDisplayBannerCalled());
 }
 
-void test_BootGenApp_WithMockOptions() {
+TEST(BasicFunctionality, BootGenApp_WithMockOptions) {
     TestableBootGenApp app;
     MockOptions mockOpts;
     app.SetMockOptions(&mockOpts);
@@ -81,18 +81,4 @@ void test_BootGenApp_WithMockOptions() {
     EXPECT_TRUE(app.WasDisplayBannerCalled());
 }
 
-int main() {
-    std::cout << "Running Basic Functionality Tests..." << std::endl;
-    std::cout << "====================================" << std::endl;
-
-    RUN_TEST(test_BootGenApp_RunWithValidBifFile);
-    RUN_TEST(test_BootGenApp_RunWithEmptyBifFile);
-    RUN_TEST(test_BootGenApp_RunWithHelpArgument);
-    RUN_TEST(test_BootGenApp_RunWithMultipleArguments);
-    RUN_TEST(test_BootGenApp_WithMockOptions);
-
-    print_test_summary();
-    generate_test_report("basic_functionality_report.txt");
-    
-    return get_exit_code();
-}
+TEST_SUITE(basic_functionality, "Basic Functionality Tests", "basic_functionality_report.txt");
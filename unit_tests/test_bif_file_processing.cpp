@@ -18,20 +18,20 @@
 #include "test_framework.h"
 #include "mock_classes.h"
 
-void test_BIF_File_ValidFilename() {
+TEST(BifFileProcessing, BIF_File_ValidFilename) {
     MockBIF_File bif("valid.bif");
     EXPECT_TRUE(bif.IsValid());
     EXPECT_STREQ("valid.bif", bif.filename.c_str());
     EXPECT_TRUE(bif.GetErrorMessage().empty());
 }
 
-void test_BIF_File_EmptyFilename() {
+TEST(BifFileProcessing, BIF_File_EmptyFilename) {
     MockBIF_File bif("");
     EXPECT_FALSE(bif.IsValid());
     EXPECT_STREQ("Empty filename provided", bif.GetErrorMessage().c_str());
 }
 
-void test_BIF_File_LongFilename() {
+TEST(BifFileProcessing, BIF_File_LongFilename) {
     std::string longName(1001, 'a');
     longName += ".bif";
     
@@ -40,13 +40,13 @@ void test_BIF_File_LongFilename() {
     EXPECT_STREQ("Filename too long", bif.GetErrorMessage().c_str());
 }
 
-void test_BIF_File_InvalidPattern() {
+TEST(BifFileProcessing, BIF_File_InvalidPattern) {
     MockBIF_File bif("invalid_pattern.bif");
     EXPECT_FALSE(bif.IsValid());
     EXPECT_STREQ("Invalid filename pattern", bif.GetErrorMessage().c_str());
 }
 
-void test_BIF_File_ProcessValid() {
+TEST(BifFileProcessing, BIF_File_ProcessValid) {
     MockBIF_File bif("test.bif");
     MockOptions options;
     
@@ -57,7 +57,7 @@ void test_BIF_File_ProcessValid() {
     EXPECT_TRUE(bif.processCalled);
 }
 
-void test_BIF_File_ProcessInvalid() {
+TEST(BifFileProcessing, BIF_File_ProcessInvalid) {
     MockBIF_File bif("");  // Empty filename
     MockOptions options;
     
@@ -66,7 +66,7 @@ void test_BIF_File_ProcessInvalid() {
     }, std::runtime_error);
 }
 
-void test_BIF_File_ProcessWithThrowPattern() {
+TEST(BifFileProcessing, BIF_File_ProcessWithThrowPattern) {
     MockBIF_File bif("throw_error.bif");
     MockOptions options;
     
@@ -75,7 +75,7 @@ void test_BIF_File_ProcessWithThrowPattern() {
     }, std::runtime_error);
 }
 
-void test_BIF_File_MultipleFiles() {
+TEST(BifFileProcessing, BIF_File_MultipleFiles) {
     std::vector<std::string> filenames = {
         "file1.bif",
         "file2.bif", 
@@ -96,7 +96,7 @@ void test_BIF_File_MultipleFiles() {
     }
 }
 
-void test_BIF_File_EdgeCases() {
+TEST(BifFileProcessing, BIF_File_EdgeCases) {
     // Test various edge cases
     std::vector<std::pair<std::string, bool>> testCases = {
         {"normal.bif", true},
@@ -123,7 +123,7 @@ void test_BIF_File_EdgeCases() {
     }
 }
 
-void test_BIF_File_ProcessingState() {
+TEST(BifFileProcessing, BIF_File_ProcessingState) {
     MockBIF_File bif("state_test.bif");
     MockOptions options;
     
@@ -136,23 +136,4 @@ void test_BIF_File_ProcessingState() {
     EXPECT_TRUE(bif.processCalled);
 }
 
-int main() {
-    std::cout << "Running BIF File Processing Tests..." << std::endl;
-    std::cout << "====================================" << std::endl;
-
-    RUN_TEST(test_BIF_File_ValidFilename);
-    RUN_TEST(test_BIF_File_EmptyFilename);
-    RUN_TEST(test_BIF_File_LongFilename);
-    RUN_TEST(test_BIF_File_InvalidPattern);
-    RUN_TEST(test_BIF_File_ProcessValid);
-    RUN_TEST(test_BIF_File_ProcessInvalid);
-    RUN_TEST(test_BIF_File_ProcessWithThrowPattern);
-    RUN_TEST(test_BIF_File_MultipleFiles);
-    RUN_TEST(test_BIF_File_EdgeCases);
-    RUN_TEST(test_BIF_File_ProcessingState);
-
-    print_test_summary();
-    generate_test_report("bif_file_processing_report.txt");
-    
-    return get_exit_code();
-}
+TEST_SUITE(bif_file_processing, "BIF File Processing Tests", "bif_file_processing_report.txt");
@@ -36,7 +36,7 @@ int SimulateMain(int argc, const char* argv[]) {
     }
 }
 
-void test_MainFunction_SuccessfulExecution() {
+TEST(ExceptionHandling, MainFunction_SuccessfulExecution) {
     const char* argv[] = {"bootgen", "-help"};
     int result = SimulateMain(2, argv);
     
@@ -44,7 +44,7 @@ void test_MainFunction_SuccessfulExecution() {
     EXPECT_EQ(0, result);
 }
 
-void test_MainFunction_CatchStdException() {
+TEST(ExceptionHandling, MainFunction_CatchStdException) {
     // Test std::exception handling
     try {
         throw std::runtime_error("Test error message");
@@ -55,7 +55,7 @@ void test_MainFunction_CatchStdException() {
     }
 }
 
-void test_MainFunction_CatchCharPointerException() {
+TEST(ExceptionHandling, MainFunction_CatchCharPointerException) {
     // Test const char* exception handling
     try {
         throw "Internal assertion failed";
@@ -66,7 +66,7 @@ void test_MainFunction_CatchCharPointerException() {
     }
 }
 
-void test_MainFunction_CatchUnknownException() {
+TEST(ExceptionHandling, MainFunction_CatchUnknownException) {
     // Test unknown exception handling
     bool caught_unknown = false;
     try {
@@ -78,7 +78,7 @@ void test_MainFunction_CatchUnknownException() {
     EXPECT_TRUE(caught_unknown);
 }
 
-void test_MainFunction_ExceptionReturnCodes() {
+TEST(ExceptionHandling, MainFunction_ExceptionReturnCodes) {
     // Test that different exception types return different codes
     
     // Test with a function that throws std::exception
@@ -127,7 +127,7 @@ void test_MainFunction_ExceptionReturnCodes() {
     EXPECT_EQ(3, throw_unknown_exception());
 }
 
-void test_ExceptionSafety_NestedTryCatch() {
+TEST(ExceptionHandling, ExceptionSafety_NestedTryCatch) {
     bool inner_caught = false;
     bool outer_caught = false;
     
@@ -148,7 +148,7 @@ void test_ExceptionSafety_NestedTryCatch() {
     EXPECT_TRUE(outer_caught);
 }
 
-void test_ExceptionSafety_MultipleExceptionTypes() {
+TEST(ExceptionHandling, ExceptionSafety_MultipleExceptionTypes) {
     std::vector<int> results;
     
     // Test multiple exception types in sequence
@@ -170,13 +170,13 @@ void test_ExceptionSafety_MultipleExceptionTypes() {
         }
     }
     
-    EXPECT_EQ(3, results.size());
+    EXPECT_EQ(3u, results.size());
     EXPECT_EQ(1, results[0]);
     EXPECT_EQ(2, results[1]);
     EXPECT_EQ(3, results[2]);
 }
 
-void test_ExceptionSafety_ResourceCleanup() {
+TEST(ExceptionHandling, ExceptionSafety_ResourceCleanup) {
     // Test that resources are cleaned up properly during exceptions
     bool cleanup_called = false;
     
@@ -196,21 +196,4 @@ void test_ExceptionSafety_ResourceCleanup() {
     EXPECT_TRUE(cleanup_called);
 }
 
-int main() {
-    std::cout << "Running Exception Handling Tests..." << std::endl;
-    std::cout << "===================================" << std::endl;
-
-    RUN_TEST(test_MainFunction_SuccessfulExecution);
-    RUN_TEST(test_MainFunction_CatchStdException);
-    RUN_TEST(test_MainFunction_CatchCharPointerException);
-    RUN_TEST(test_MainFunction_CatchUnknownException);
-    RUN_TEST(test_MainFunction_ExceptionReturnCodes);
-    RUN_TEST(test_ExceptionSafety_NestedTryCatch);
-    RUN_TEST(test_ExceptionSafety_MultipleExceptionTypes);
-    RUN_TEST(test_ExceptionSafety_ResourceCleanup);
-
-    print_test_summary();
-    generate_test_report("exception_handling_report.txt");
-    
-    return get_exit_code();
-}
+TEST_SUITE(exception_handling, "Exception Handling Tests", "exception_handling_report.txt");
@@ -16,7 +16,60 @@
 ******************************************************************************/
 
 #include "test_framework.h"
+#include "test_statistics.h"
+#include "test_history.h"
 #include <iomanip>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <cstdint>
+#include <new>
+#include <atomic>
+#include <set>
+#include <condition_variable>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define TEST_HAVE_TSC 1
+#endif
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <poll.h>
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#define TEST_HAVE_PROFILER 1
+#define TEST_HAVE_BACKTRACE 1
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <sched.h>
+#define TEST_HAVE_PERF_EVENTS 1
+#define TEST_HAVE_PROC_RESOURCES 1
+#define TEST_HAVE_BENCH_ISOLATION 1
+#endif
 
 // Global test counters
 int g_tests_passed = 0;
@@ -24,7 +77,3340 @@ int g_tests_failed = 0;
 std::vector<std::string> g_failed_tests;
 std::vector<TestResult> g_test_results;
 
-void generate_test_report(const std::string& filename) {
+// Heap accounting. The global operator new/delete are replaced so that every
+// allocation is counted against the thread that made it; the runner turns the
+// counters into per-test numbers. Each block carries a 16-byte header (which
+// keeps malloc's alignment) holding its size and whether it was counted, so
+// frees balance even for blocks allocated while counting was paused.
+// Define BOOTGEN_TEST_NO_ALLOC_HOOKS to keep the default allocator.
+namespace {
+
+struct AllocationCounters {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytes;
+    int64_t liveBytes;
+    int64_t peakLiveBytes;
+    unsigned paused;            // Framework bookkeeping is not charged to tests
+};
+
+// Plain zero-initialised data, so using it inside operator new needs no TLS constructor
+thread_local AllocationCounters t_allocations;
+
+#ifndef BOOTGEN_TEST_NO_ALLOC_HOOKS
+const bool kAllocationHooks = true;
+const size_t kAllocationHeader = 16;
+
+void* counted_allocate(std::size_t size) {
+    void* block;
+    while ((block = std::malloc(size + kAllocationHeader)) == nullptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+    AllocationCounters& counters = t_allocations;
+    uint64_t* header = static_cast<uint64_t*>(block);
+    header[0] = size;
+    header[1] = counters.paused ? 0 : 1;
+    if (!counters.paused) {
+        counters.allocations++;
+        counters.bytes += size;
+        counters.liveBytes += static_cast<int64_t>(size);
+        if (counters.liveBytes > counters.peakLiveBytes) counters.peakLiveBytes = counters.liveBytes;
+    }
+    return static_cast<char*>(block) + kAllocationHeader;
+}
+
+void counted_free(void* pointer) {
+    if (!pointer) return;
+    char* block = static_cast<char*>(pointer) - kAllocationHeader;
+    const uint64_t* header = reinterpret_cast<const uint64_t*>(block);
+    if (header[1]) {
+        AllocationCounters& counters = t_allocations;
+        counters.frees++;
+        counters.liveBytes -= static_cast<int64_t>(header[0]);
+    }
+    std::free(block);
+}
+#else
+const bool kAllocationHooks = false;
+#endif
+
+} // namespace
+
+#ifndef BOOTGEN_TEST_NO_ALLOC_HOOKS
+void* operator new(std::size_t size) { return counted_allocate(size); }
+void* operator new[](std::size_t size) { return counted_allocate(size); }
+void operator delete(void* pointer) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer) noexcept { counted_free(pointer); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return counted_allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return counted_allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { counted_free(pointer); }
+#endif
+
+namespace {
+
+struct RegisteredTest {
+    std::string suite;
+    std::string name;       // Full name: "Suite.Name", or the bare function name for RUN_TEST
+    TestFunction func = nullptr;
+    BenchmarkFunction benchmark = nullptr;
+    double timeoutSeconds = 0.0;    // From TestOptions; 0 = RunOptions::timeoutSeconds
+    const char* file = nullptr;     // Registering source file; matched against TestSuite::file
+};
+
+// Declared by TEST_SUITE, one per linked test_*.cpp
+struct TestSuite {
+    std::string name;
+    std::string title;
+    std::string reportFile;
+    const char* file = nullptr;
+    const char* note = nullptr;
+    SuiteEpilogue epilogue = nullptr;
+};
+
+// Per-thread sink behind test_output(). Lines written by a test go into a
+// small ring and are dropped when the test passes; a failure moves the ring,
+// i.e. the lines leading up to it, into the kept output. With --verbose every
+// line is kept. Nothing reaches stdout until the test has finished, so logging
+// an assertion costs a copy into memory instead of a flush.
+class TestLog : public std::streambuf {
+public:
+    static const size_t kContextLines = 32;
+
+    TestLog() : stream_(this), ring_(kContextLines) {}
+
+    std::ostream& stream() { return stream_; }
+
+    void begin(bool verbose) {
+        verbose_ = verbose;
+        kept_.clear();
+        line_.clear();
+        head_ = 0;
+        count_ = 0;
+        dropped_ = 0;
+        // Formatting state set by the previous test on this thread must not leak
+        stream_.clear();
+        stream_.flags(std::ios_base::dec | std::ios_base::skipws);
+        stream_.precision(6);
+        stream_.width(0);
+        stream_.fill(' ');
+    }
+
+    // Appends text that is printed whether or not the test fails
+    void keep(const std::string& text) {
+        test_internal::AllocationPause pause;
+        kept_ += text;
+    }
+
+    // Moves the buffered lines into the kept output; called on every failure
+    void flush_context() {
+        test_internal::AllocationPause pause;
+        if (dropped_ > 0) {
+            kept_ += "[... " + std::to_string(dropped_) + " earlier lines not shown ...]\n";
+            dropped_ = 0;
+        }
+        size_t first = (head_ + kContextLines - count_) % kContextLines;
+        for (size_t k = 0; k < count_; ++k) {
+            kept_ += ring_[(first + k) % kContextLines];
+        }
+        count_ = 0;
+    }
+
+    // Hands over the kept output; an unterminated last line is completed first
+    void finish(std::string& output) {
+        if (!line_.empty()) {
+            line_ += '\n';
+            commit_line();
+        }
+        output.swap(kept_);
+        kept_.clear();
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+        test_internal::AllocationPause pause;
+        char ch = traits_type::to_char_type(c);
+        line_ += ch;
+        if (ch == '\n') commit_line();
+        return c;
+    }
+
+    std::streamsize xsputn(const char* text, std::streamsize size) override {
+        test_internal::AllocationPause pause;
+        const char* end = text + size;
+        while (text < end) {
+            const char* newline = static_cast<const char*>(std::memchr(text, '\n', end - text));
+            if (!newline) {
+                line_.append(text, end - text);
+                break;
+            }
+            line_.append(text, newline + 1 - text);
+            commit_line();
+            text = newline + 1;
+        }
+        return size;
+    }
+
+private:
+    void commit_line() {
+        if (verbose_) {
+            kept_ += line_;
+        } else {
+            // Swapping keeps every slot's capacity, so a warm ring does not allocate
+            if (count_ == kContextLines) dropped_++; else count_++;
+            ring_[head_].swap(line_);
+            head_ = (head_ + 1) % kContextLines;
+        }
+        line_.clear();
+    }
+
+    std::ostream stream_;
+    std::vector<std::string> ring_;
+    size_t head_ = 0;       // Next slot to write
+    size_t count_ = 0;      // Lines currently held, ending just before head_
+    size_t dropped_ = 0;    // Lines overwritten since the last flush
+    bool verbose_ = false;
+    std::string line_;
+    std::string kept_;
+};
+
+// One complete ("ph":"X") span of the --trace timeline
+struct TraceEvent {
+    std::string name;
+    std::string category;
+    uint64_t startNs = 0;
+    uint64_t durationNs = 0;
+    unsigned lane = 0;          // Timeline row: 0 is the main thread, N is worker N-1
+};
+
+// Counters and output of the test currently running on this thread
+struct TestContext {
+    const std::string* testName = nullptr;
+    int passed = 0;
+    int failed = 0;
+    std::vector<std::string> failedTests;
+    TestLog* log = nullptr;
+    std::vector<TraceEvent>* trace = nullptr;
+};
+
+struct TestOutcome {
+    TestResult result;
+    std::vector<std::string> failedTests;
+    std::string output;
+    std::vector<TraceEvent> trace;  // Spans recorded while the test ran
+    bool ran = false;
+};
+
+struct RunOptions {
+    unsigned jobs = 1;
+    bool isolate = false;
+    unsigned shardIndex = 0;
+    unsigned shardCount = 1;
+    std::string durationsFile;      // Explicit history; also balances shards
+    bool history = true;            // Without durationsFile, keep <binary>.durations
+    std::string filter;
+    std::string exclude;
+    bool list = false;
+    bool verbose = false;
+    bool tscTimer = false;
+    unsigned benchSamples = 30;
+    unsigned benchTimeMs = 5;   // Target duration of one measured batch
+    bool benchmarksOnly = false;
+    std::string benchBaseline;
+    std::string benchSaveBaseline;
+    std::string historyStore;       // Non-empty: append this run's metrics here
+    std::string commit;             // Commit the history records; default: git rev-parse
+    double benchMaxSlowdown = 10.0; // Percent
+    double benchAlpha = 0.01;
+    bool benchIsolate = false;      // Pin, prioritize and spin up the benchmark thread
+    int benchCpu = -1;              // Core for --bench-isolate; -1 = the last one the process may use
+    bool perfCounters = true;
+    std::string profileDir;         // Non-empty: sample every test and write folded stacks here
+    unsigned profileHz = 1000;
+    std::string traceFile;          // Non-empty: write a Chrome trace-event timeline here
+    std::string jsonlReport;        // Non-empty: stream one JSON line per test here
+    std::string junitReport;        // Non-empty: stream JUnit XML here
+    double timeoutSeconds = 0.0;    // Per-test default; 0 = no limit
+    double globalTimeoutSeconds = 0.0;
+    unsigned repeat = 1;            // Runs per test; above 1, flaky and noisy tests are flagged
+    double maxCv = 0.25;            // Duration coefficient of variation above which a test is noisy
+    std::string quarantineFile;     // Tests whose failures do not fail the run
+};
+
+// Options of the current run; generate_test_report() needs the shard identity
+RunOptions g_run_options;
+
+std::vector<RegisteredTest>& registered_tests() {
+    static std::vector<RegisteredTest> tests;
+    return tests;
+}
+
+std::vector<TestSuite>& test_suites() {
+    static std::vector<TestSuite> suites;
+    return suites;
+}
+
+// Clock behind test durations. steady_clock unless --timer=tsc selected the
+// time-stamp counter, whose rate is calibrated against steady_clock once
+// before any test runs (and before zygotes fork, so children inherit it).
+class TestTimer {
+public:
+    bool use_tsc() {
+#ifdef TEST_HAVE_TSC
+        unsigned eax, ebx, ecx, edx;
+        // CPUID 0x80000007 EDX bit 8: the TSC ticks at a constant rate in all P/C-states
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) {
+            return false;
+        }
+        auto wall_start = std::chrono::steady_clock::now();
+        uint64_t tsc_start = read_tsc();
+        while (std::chrono::steady_clock::now() - wall_start < std::chrono::milliseconds(20)) {}
+        uint64_t tsc_end = read_tsc();
+        auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wall_start);
+        if (tsc_end <= tsc_start) return false;
+        nsPerTick_ = static_cast<double>(wall.count()) / static_cast<double>(tsc_end - tsc_start);
+        tsc_ = true;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    uint64_t now() const {
+#ifdef TEST_HAVE_TSC
+        if (tsc_) return read_tsc();
+#endif
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    std::chrono::nanoseconds elapsed(uint64_t start, uint64_t end) const {
+        uint64_t ticks = end > start ? end - start : 0;
+        if (!tsc_) return std::chrono::nanoseconds(static_cast<int64_t>(ticks));
+        return std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(ticks) * nsPerTick_ + 0.5));
+    }
+
+    std::string describe() const {
+        if (!tsc_) return "steady_clock";
+        std::ostringstream text;
+        text << "tsc (" << std::fixed << std::setprecision(3) << 1.0 / nsPerTick_ << " GHz)";
+        return text.str();
+    }
+
+private:
+#ifdef TEST_HAVE_TSC
+    static uint64_t read_tsc() {
+        // lfence keeps the read from drifting ahead of earlier instructions
+        _mm_lfence();
+        return __rdtsc();
+    }
+#endif
+
+    bool tsc_ = false;
+    double nsPerTick_ = 1.0;
+};
+
+TestTimer g_timer;
+
+// Written by benchmark_escape(); volatile so the store cannot be elided
+const void* volatile g_benchmark_sink = nullptr;
+
+// Baseline samples per benchmark, loaded before any test (or zygote) starts
+std::map<std::string, std::vector<double> > g_benchmark_baseline;
+
+std::string format_nanoseconds(double ns) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3);
+    if (ns < 1e3) {
+        text << std::setprecision(1) << ns << " ns";
+    } else if (ns < 1e6) {
+        text << ns / 1e3 << " us";
+    } else if (ns < 1e9) {
+        text << ns / 1e6 << " ms";
+    } else {
+        text << ns / 1e9 << " s";
+    }
+    return text.str();
+}
+
+// Hardware counters of the calling thread, opened as one perf_event group so
+// that every value covers the same interval. Events the CPU, hypervisor or
+// perf_event_paranoid setting refuse are left out, and if none open the test
+// simply has no counters. Counting is user-space only.
+class PerfCounterGroup {
+public:
+    enum Event { kCycles, kInstructions, kL1dMisses, kLlcMisses, kBranchMisses, kEventCount };
+
+    struct Snapshot {
+        uint64_t enabled = 0;
+        uint64_t running = 0;
+        uint64_t values[kEventCount] = {};
+    };
+
+    PerfCounterGroup() {
+        for (int& slot : slots_) slot = -1;
+    }
+
+    ~PerfCounterGroup() {
+#ifdef TEST_HAVE_PERF_EVENTS
+        for (int fd : fds_) ::close(fd);
+#endif
+    }
+
+    // Opens the group on first use; false when no counter is available
+    bool ready() {
+        if (!tried_) {
+            tried_ = true;
+            open();
+        }
+        return !fds_.empty();
+    }
+
+    bool read(Snapshot& snapshot) const {
+#ifdef TEST_HAVE_PERF_EVENTS
+        // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, value[nr]
+        uint64_t buffer[3 + kEventCount];
+        ssize_t size = ::read(fds_.front(), buffer, sizeof(buffer));
+        if (size < static_cast<ssize_t>(3 * sizeof(uint64_t)) || buffer[0] != fds_.size()) return false;
+        snapshot.enabled = buffer[1];
+        snapshot.running = buffer[2];
+        for (int event = 0; event < kEventCount; ++event) {
+            snapshot.values[event] = slots_[event] >= 0 ? buffer[3 + slots_[event]] : 0;
+        }
+        return true;
+#else
+        (void)snapshot;
+        return false;
+#endif
+    }
+
+    // Counts between two snapshots, scaled up if the kernel multiplexed the group
+    void difference(const Snapshot& before, const Snapshot& after, PerfCounters& counters) const {
+        uint64_t enabled = after.enabled - before.enabled;
+        uint64_t running = after.running - before.running;
+        double scale = (running > 0 && running < enabled) ? static_cast<double>(enabled) / static_cast<double>(running) : 1.0;
+        int64_t* fields[kEventCount] = { &counters.cycles, &counters.instructions, &counters.l1dMisses,
+                                         &counters.llcMisses, &counters.branchMisses };
+        for (int event = 0; event < kEventCount; ++event) {
+            *fields[event] = slots_[event] < 0 ? -1
+                : static_cast<int64_t>(static_cast<double>(after.values[event] - before.values[event]) * scale + 0.5);
+        }
+    }
+
+private:
+    void open() {
+#ifdef TEST_HAVE_PERF_EVENTS
+        const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const struct { uint32_t type; uint64_t config; } events[kEventCount] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HW_CACHE, l1d_read_miss },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+        for (int event = 0; event < kEventCount; ++event) {
+            struct perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[event].type;
+            attr.config = events[event].config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int leader = fds_.empty() ? -1 : fds_.front();
+            int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0) continue;
+            slots_[event] = static_cast<int>(fds_.size());
+            fds_.push_back(fd);
+        }
+        if (!fds_.empty()) {
+            ::ioctl(fds_.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    bool tried_ = false;
+    std::vector<int> fds_;          // Group leader first
+    int slots_[kEventCount];        // Position of each event in a group read, -1 if not opened
+};
+
+thread_local TestContext* t_context = nullptr;
+thread_local PerfCounterGroup t_perf_counters;
+
+// Memory and scheduler activity sampled around a test. Faults and context
+// switches come from getrusage(RUSAGE_THREAD) and so belong to the test's
+// thread; RSS (/proc/self/statm) and its peak (VmHWM) are process-wide.
+struct ResourceSample {
+    bool valid = false;
+    int64_t rssBytes = 0;
+    int64_t minorFaults = 0;
+    int64_t majorFaults = 0;
+    int64_t voluntarySwitches = 0;
+    int64_t involuntarySwitches = 0;
+};
+
+#ifdef TEST_HAVE_PROC_RESOURCES
+int64_t read_rss_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    int64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return -1;
+    return resident * static_cast<int64_t>(::sysconf(_SC_PAGESIZE));
+}
+
+int64_t read_peak_rss_bytes() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::strtoll(line.c_str() + 6, nullptr, 10) * 1024;   // Reported in kB
+        }
+    }
+    return -1;
+}
+
+// Writing 5 to clear_refs (Linux 4.0+) resets VmHWM to the current RSS
+bool reset_peak_rss() {
+    int fd = ::open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool reset = ::write(fd, "5", 1) == 1;
+    ::close(fd);
+    return reset;
+}
+#endif
+
+ResourceSample sample_resources() {
+    ResourceSample sample;
+#ifdef TEST_HAVE_PROC_RESOURCES
+    struct rusage usage;
+    if (::getrusage(RUSAGE_THREAD, &usage) != 0) return sample;
+    sample.rssBytes = read_rss_bytes();
+    sample.minorFaults = usage.ru_minflt;
+    sample.majorFaults = usage.ru_majflt;
+    sample.voluntarySwitches = usage.ru_nvcsw;
+    sample.involuntarySwitches = usage.ru_nivcsw;
+    sample.valid = sample.rssBytes >= 0;
+#endif
+    return sample;
+}
+
+// Sampling profiler for --profile. An ITIMER_PROF timer raises SIGPROF as the
+// process burns CPU; the handler appends the interrupted thread's call stack
+// to that thread's preallocated buffer (no locks, no allocation), and after
+// each test the stacks are symbolised and written as folded stacks
+// ("root;caller;leaf count") for flamegraph.pl, speedscope and friends.
+// The signal lands on whichever thread was running, so with --jobs samples
+// still belong to the right test.
+#ifdef TEST_HAVE_PROFILER
+class SamplingProfiler {
+public:
+    static const size_t kMaxSamples = 4096;
+    static const int kMaxFrames = 64;
+    static const int kSkipFrames = 2;       // The handler and the signal trampoline
+
+    struct Sample {
+        int depth;
+        void* frames[kMaxFrames];
+    };
+
+    struct Buffer {
+        std::atomic<bool> active{false};
+        std::atomic<size_t> count{0};
+        Sample samples[kMaxSamples];
+    };
+
+    static bool install(unsigned hz) {
+        // The first backtrace() may load the unwinder, which must not happen in the handler
+        void* warm_up[4];
+        ::backtrace(warm_up, 4);
+
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = handle_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (::sigaction(SIGPROF, &action, nullptr) != 0) return false;
+        interval_us() = hz > 0 ? 1000000 / hz : 1000;
+        if (interval_us() == 0) interval_us() = 1;
+        return start_timer();
+    }
+
+    // Interval timers are not inherited across fork(), so isolated children re-arm theirs
+    static bool start_timer() {
+        struct itimerval timer;
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = static_cast<suseconds_t>(interval_us());
+        timer.it_value = timer.it_interval;
+        if (::setitimer(ITIMER_PROF, &timer, nullptr) != 0) return false;
+        timer_pid() = ::getpid();
+        return true;
+    }
+
+    static void stop_timer() {
+        struct itimerval timer;
+        std::memset(&timer, 0, sizeof(timer));
+        ::setitimer(ITIMER_PROF, &timer, nullptr);
+    }
+
+    static void begin_test() {
+        if (timer_pid() != ::getpid()) start_timer();
+        if (!t_buffer) {
+            test_internal::AllocationPause pause;
+            t_buffer = new Buffer;
+        }
+        t_buffer->count.store(0, std::memory_order_relaxed);
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        t_buffer->active.store(true, std::memory_order_release);
+    }
+
+    // Stops sampling this thread and writes <dir>/<test>.folded; returns a summary line
+    static std::string end_test(const std::string& dir, const std::string& testName, const void* testFunction) {
+        t_buffer->active.store(false, std::memory_order_release);
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        test_internal::AllocationPause pause;
+
+        size_t taken = t_buffer->count.load(std::memory_order_relaxed);
+        size_t kept = std::min(taken, kMaxSamples);
+        std::map<std::string, size_t> folded;
+        std::map<void*, std::pair<std::string, const void*> > symbols;
+        for (size_t k = 0; k < kept; ++k) {
+            const Sample& sample = t_buffer->samples[k];
+            // Walk from the root towards the leaf, starting at the test body when it is on the stack
+            int root = sample.depth - 1;
+            for (int f = kSkipFrames; f < sample.depth; ++f) {
+                if (symbol_for(sample.frames[f], symbols).second == testFunction) {
+                    root = f;
+                    break;
+                }
+            }
+            std::string stack;
+            for (int f = root; f >= kSkipFrames; --f) {
+                if (!stack.empty()) stack += ';';
+                stack += symbol_for(sample.frames[f], symbols).first;
+            }
+            if (!stack.empty()) folded[stack]++;
+        }
+
+        std::string path = dir + "/" + testName + ".folded";
+        std::ofstream out(path.c_str());
+        for (const auto& entry : folded) {
+            out << entry.first << ' ' << entry.second << '\n';
+        }
+        std::ostringstream line;
+        line << "[PROFILE] " << kept << " samples";
+        if (taken > kept) line << " (" << (taken - kept) << " dropped)";
+        line << (out ? " -> " : ", could not write ") << path << "\n";
+        return line.str();
+    }
+
+private:
+    static void handle_signal(int) {
+        int saved_errno = errno;
+        Buffer* buffer = t_buffer;
+        if (buffer && buffer->active.load(std::memory_order_acquire)) {
+            size_t slot = buffer->count.fetch_add(1, std::memory_order_relaxed);
+            if (slot < kMaxSamples) {
+                Sample& sample = buffer->samples[slot];
+                sample.depth = ::backtrace(sample.frames, kMaxFrames);
+            }
+        }
+        errno = saved_errno;
+    }
+
+    // Demangled function name and start address of the function containing 'address'
+    static const std::pair<std::string, const void*>& symbol_for(
+            void* address, std::map<void*, std::pair<std::string, const void*> >& cache) {
+        auto it = cache.find(address);
+        if (it != cache.end()) return it->second;
+
+        std::pair<std::string, const void*> symbol("", nullptr);
+        Dl_info info;
+        if (::dladdr(address, &info) && info.dli_sname) {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            symbol.first = (status == 0 && demangled) ? demangled : info.dli_sname;
+            std::free(demangled);
+            symbol.second = info.dli_saddr;
+        } else {
+            std::ostringstream name;
+            const char* module = (info.dli_fname && ::dladdr(address, &info)) ? std::strrchr(info.dli_fname, '/') : nullptr;
+            name << "[" << (module ? module + 1 : "unknown") << "+0x" << std::hex
+                 << (reinterpret_cast<uintptr_t>(address) - reinterpret_cast<uintptr_t>(info.dli_fbase)) << "]";
+            symbol.first = name.str();
+        }
+        // ';' separates frames and the last ' ' the count in the folded format
+        std::replace(symbol.first.begin(), symbol.first.end(), ';', ':');
+        return cache.insert(std::make_pair(address, symbol)).first->second;
+    }
+
+    static unsigned& interval_us() {
+        static unsigned interval = 1000;
+        return interval;
+    }
+
+    static pid_t& timer_pid() {
+        static pid_t pid = 0;
+        return pid;
+    }
+
+    static thread_local Buffer* t_buffer;
+};
+
+thread_local SamplingProfiler::Buffer* SamplingProfiler::t_buffer = nullptr;
+
+bool g_profiler_running = false;
+#endif
+thread_local TestLog t_log;
+
+std::mutex g_output_mutex;
+
+// Spans recorded outside any test (workers, isolation round trips); spans
+// inside a test go to its outcome so isolated children can send them back
+std::mutex g_trace_mutex;
+std::vector<TraceEvent> g_trace_events;
+uint64_t g_trace_origin = 0;
+thread_local unsigned t_trace_lane = 0;
+thread_local bool t_trace_muted = false;   // Set while benchmark batches run
+
+// Start time for a span, or 0 when tracing is off
+uint64_t trace_start() {
+    return test_internal::g_trace_enabled ? test_internal::trace_clock() : 0;
+}
+
+void trace_end(const char* name, const char* category, uint64_t start) {
+    if (start) test_internal::trace_span(name, category, start);
+}
+
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += static_cast<char>(c);
+            }
+        }
+    }
+    return escaped;
+}
+
+void write_trace_file(const std::string& path, const std::vector<TraceEvent>& events, unsigned workers) {
+    std::ofstream out(path.c_str());
+    if (!out) {
+        std::cerr << "Could not write trace file: " << path << std::endl;
+        return;
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"tests\"}}";
+    for (unsigned lane = 0; lane <= workers; ++lane) {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane << ",\"args\":{\"name\":\"";
+        if (lane == 0) {
+            out << "main";
+        } else {
+            out << "worker " << (lane - 1);
+        }
+        out << "\"}}";
+    }
+    out << std::fixed << std::setprecision(3);
+    for (const TraceEvent& event : events) {
+        uint64_t start = event.startNs > g_trace_origin ? event.startNs - g_trace_origin : 0;
+        out << ",\n{\"name\":\"" << json_escape(event.name) << "\",\"cat\":\"" << json_escape(event.category)
+            << "\",\"ph\":\"X\",\"ts\":" << static_cast<double>(start) / 1000.0
+            << ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0
+            << ",\"pid\":1,\"tid\":" << event.lane << "}";
+    }
+    out << "\n]}\n";
+    std::cout << "Trace written to " << path << std::endl;
+}
+
+std::string xml_escape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (unsigned char c : text) {
+        switch (c) {
+        case '&': escaped += "&amp;"; break;
+        case '<': escaped += "&lt;"; break;
+        case '>': escaped += "&gt;"; break;
+        case '"': escaped += "&quot;"; break;
+        default:
+            // XML 1.0 cannot carry other control characters, even escaped
+            if (c >= 0x20 || c == '\t' || c == '\n' || c == '\r') escaped += static_cast<char>(c);
+        }
+    }
+    return escaped;
+}
+
+// Machine-readable reports are streamed: each test's record is written and
+// flushed as soon as the test finishes and nothing is kept in memory, so a
+// binary that dies mid-run still leaves a usable report of what completed.
+
+// One JSON object per line: a "test" record per test and a final "summary"
+// record. A file without the summary line comes from an interrupted run.
+class JsonLinesReport {
+public:
+    bool open(const std::string& path) {
+        out_.open(path.c_str(), std::ios::out | std::ios::trunc);
+        return out_.is_open();
+    }
+
+    bool is_open() const { return out_.is_open(); }
+
+    void write(const RegisteredTest& test, const TestResult& result) {
+        std::ostringstream line;
+        line << "{\"type\":\"test\",\"name\":\"" << json_escape(result.testName)
+             << "\",\"suite\":\"" << json_escape(test.suite)
+             << "\",\"status\":\"" << test_status_name(result.status)
+             << "\",\"duration_ns\":" << result.duration.count()
+             << ",\"assertions_passed\":" << result.assertionsPassed
+             << ",\"assertions_failed\":" << result.assertionsFailed
+             << ",\"allocations\":" << result.allocations
+             << ",\"allocated_bytes\":" << result.allocatedBytes
+             << ",\"peak_live_bytes\":" << result.peakLiveBytes;
+        if (result.counters.available()) {
+            const PerfCounters& counters = result.counters;
+            const char* names[] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses" };
+            const int64_t values[] = { counters.cycles, counters.instructions, counters.l1dMisses,
+                                       counters.llcMisses, counters.branchMisses };
+            line << ",\"counters\":{";
+            bool first = true;
+            for (size_t k = 0; k < 5; ++k) {
+                if (values[k] < 0) continue;
+                line << (first ? "" : ",") << '"' << names[k] << "\":" << values[k];
+                first = false;
+            }
+            line << '}';
+        }
+        if (result.resources.available) {
+            const ResourceUsage& usage = result.resources;
+            line << ",\"rss_delta_bytes\":" << usage.rssDeltaBytes
+                 << ",\"minor_faults\":" << usage.minorFaults
+                 << ",\"major_faults\":" << usage.majorFaults;
+            if (usage.peakRssDeltaBytes >= 0) line << ",\"peak_rss_delta_bytes\":" << usage.peakRssDeltaBytes;
+        }
+        if (!result.benchmarkSamples.empty()) {
+            SampleSummary summary = summarize_samples(result.benchmarkSamples);
+            line << std::fixed << std::setprecision(3)
+                 << ",\"benchmark\":{\"iterations\":" << result.benchmarkIterations
+                 << ",\"samples\":" << summary.count
+                 << ",\"median_ns\":" << summary.median
+                 << ",\"p90_ns\":" << summary.p90
+                 << ",\"p99_ns\":" << summary.p99
+                 << ",\"mad_ns\":" << summary.mad;
+            const BenchEnvironment& env = result.benchEnvironment;
+            if (env.recorded) {
+                line << ",\"environment\":{\"cpu\":" << env.cpu << ",\"nice\":" << env.niceness
+                     << ",\"spin_up_ms\":" << env.spinUpMs
+                     << ",\"spin_up_steady\":" << (env.spinUpSteady ? "true" : "false")
+                     << ",\"load_average\":" << env.loadAverage << ",\"cpus\":" << env.cpus
+                     << ",\"other_runnable\":" << env.otherRunnable
+                     << ",\"run_queue_wait\":" << env.runQueueWait
+                     << ",\"quiet\":" << (env.quiet ? "true" : "false") << '}';
+            }
+            line << '}';
+        }
+        if (result.repeats > 1) {
+            line << ",\"repeats\":" << result.repeats << ",\"repeat_failures\":" << result.repeatFailures
+                 << std::fixed << std::setprecision(4) << ",\"duration_cv\":" << result.durationCv
+                 << ",\"flaky\":" << (result.flaky ? "true" : "false")
+                 << ",\"noisy\":" << (result.noisy ? "true" : "false");
+        }
+        if (result.quarantined) line << ",\"quarantined\":true";
+        if (!result.errorMessage.empty()) {
+            line << ",\"error\":\"" << json_escape(result.errorMessage) << '"';
+        }
+        line << "}\n";
+        out_ << line.str() << std::flush;
+    }
+
+    void finish(size_t tests, size_t failedTests, int assertionsPassed, int assertionsFailed) {
+        out_ << "{\"type\":\"summary\",\"tests\":" << tests
+             << ",\"failed_tests\":" << failedTests
+             << ",\"assertions_passed\":" << assertionsPassed
+             << ",\"assertions_failed\":" << assertionsFailed << "}\n" << std::flush;
+    }
+
+private:
+    std::ofstream out_;
+};
+
+// JUnit XML for CI dashboards. After every test case the closing tags are
+// rewritten after it and the fixed-width counts in the <testsuite> tag are
+// updated in place, so the file is well-formed at every point of the run.
+class JUnitReport {
+public:
+    bool open(const std::string& path, const std::string& suiteName) {
+        out_.open(path.c_str(), std::ios::out | std::ios::trunc);
+        if (!out_.is_open()) return false;
+        suiteName_ = suiteName;
+        out_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n<testsuite name=\""
+             << xml_escape(suiteName) << "\" ";
+        countsPos_ = out_.tellp();
+        write_counts();
+        out_ << ">\n";
+        tailPos_ = out_.tellp();
+        write_tail();
+        return true;
+    }
+
+    bool is_open() const { return out_.is_open(); }
+
+    void write(const RegisteredTest& test, const TestOutcome& outcome) {
+        const TestResult& result = outcome.result;
+        const std::string classname = test.suite.empty() ? suiteName_ : test.suite;
+        const std::string name = test.suite.empty() ? test.name : test.name.substr(test.suite.size() + 1);
+        double seconds = static_cast<double>(result.duration.count()) / 1e9;
+
+        std::ostringstream entry;
+        entry << "  <testcase classname=\"" << xml_escape(classname) << "\" name=\"" << xml_escape(name)
+              << "\" time=\"" << std::fixed << std::setprecision(6) << seconds << '"';
+        if (result.status == TestStatus::Passed) {
+            entry << "/>\n";
+        } else {
+            const bool crashed = result.status != TestStatus::Failed;
+            const char* type = result.status == TestStatus::Timeout ? "timeout" : crashed ? "crash" : "assertion";
+            entry << ">\n    <" << (crashed ? "error" : "failure") << " message=\"" << xml_escape(result.errorMessage)
+                  << "\" type=\"" << type << "\">" << xml_escape(outcome.output)
+                  << "</" << (crashed ? "error" : "failure") << ">\n  </testcase>\n";
+            (crashed ? errors_ : failures_)++;
+        }
+        tests_++;
+        seconds_ += seconds;
+
+        out_.seekp(tailPos_);
+        out_ << entry.str();
+        tailPos_ = out_.tellp();
+        write_tail();
+        out_.seekp(countsPos_);
+        write_counts();
+        out_.flush();
+    }
+
+private:
+    static const size_t kCountsWidth = 96;
+
+    void write_counts() {
+        std::ostringstream counts;
+        counts << "tests=\"" << tests_ << "\" failures=\"" << failures_ << "\" errors=\"" << errors_
+               << "\" time=\"" << std::fixed << std::setprecision(6) << seconds_ << '"';
+        std::string text = counts.str();
+        text.resize(kCountsWidth, ' ');
+        out_ << text;
+    }
+
+    void write_tail() {
+        out_ << "</testsuite>\n</testsuites>\n";
+    }
+
+    std::ofstream out_;
+    std::string suiteName_;
+    std::streampos countsPos_;
+    std::streampos tailPos_;
+    unsigned tests_ = 0;
+    unsigned failures_ = 0;
+    unsigned errors_ = 0;
+    double seconds_ = 0.0;
+};
+
+std::mutex g_report_mutex;
+JsonLinesReport g_jsonl_report;
+JUnitReport g_junit_report;
+
+void stream_outcome(const RegisteredTest& test, const TestOutcome& outcome) {
+    if (!g_jsonl_report.is_open() && !g_junit_report.is_open()) return;
+    test_internal::AllocationPause pause;
+    std::lock_guard<std::mutex> lock(g_report_mutex);
+    if (g_jsonl_report.is_open()) g_jsonl_report.write(test, outcome.result);
+    if (g_junit_report.is_open()) g_junit_report.write(test, outcome);
+}
+
+// Work-stealing queue: the owning worker takes from the front, idle workers
+// steal from the back so contention only happens once a queue runs dry.
+class WorkQueue {
+public:
+    void push(size_t index) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.push_back(index);
+    }
+
+    bool pop(size_t& index) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.empty()) return false;
+        index = items_.front();
+        items_.pop_front();
+        return true;
+    }
+
+    bool steal(size_t& index) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.empty()) return false;
+        index = items_.back();
+        items_.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<size_t> items_;
+};
+
+bool parse_unsigned(const char* text, unsigned& number) {
+    char* end = nullptr;
+    long value = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 0) return false;
+    number = static_cast<unsigned>(value);
+    return true;
+}
+
+bool parse_double(const char* text, double& number) {
+    char* end = nullptr;
+    double value = std::strtod(text, &end);
+    if (end == text || *end != '\0' || !(value >= 0)) return false;
+    number = value;
+    return true;
+}
+
+bool env_flag_set(const char* name) {
+    const char* value = std::getenv(name);
+    return value && *value && std::strcmp(value, "0") != 0;
+}
+
+void env_unsigned(const char* name, unsigned& number) {
+    const char* value = std::getenv(name);
+    if (value && !parse_unsigned(value, number)) {
+        std::cerr << "Ignoring invalid " << name << " value: " << value << std::endl;
+    }
+}
+
+void env_double(const char* name, double& number) {
+    const char* value = std::getenv(name);
+    if (value && !parse_double(value, number)) {
+        std::cerr << "Ignoring invalid " << name << " value: " << value << std::endl;
+    }
+}
+
+// Matches "--name value" and "--name=value"; advances i past a separate value
+bool match_option(const std::string& arg, const char* name, int& i, int argc, char* argv[],
+                  const char*& value) {
+    size_t length = std::strlen(name);
+    if (arg.compare(0, length, name) != 0) return false;
+    if (arg.size() == length && i + 1 < argc) {
+        value = argv[++i];
+        return true;
+    }
+    if (arg.size() > length && arg[length] == '=') {
+        value = argv[i] + length + 1;
+        return true;
+    }
+    return false;
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  -j, --jobs N            Run tests on N worker threads (0 = all hardware threads)" << std::endl;
+    std::cout << "  --isolate               Run every test in a child forked from a pre-forked zygote" << std::endl;
+    std::cout << "  --shard-index I         Run only shard I (0-based) of --shard-count" << std::endl;
+    std::cout << "  --shard-count N         Split the tests into N duration-balanced shards" << std::endl;
+    std::cout << "  --durations-file PATH   Per-test durations used to balance shards; updated after the run" << std::endl;
+    std::cout << "  --history-store FILE    Append this run's timings to a performance history (see bootgen_history)" << std::endl;
+    std::cout << "  --commit ID             Commit the history records are filed under (default: git HEAD)" << std::endl;
+    std::cout << "  --no-history            Do not read or update <binary>.durations (longest-first scheduling)" << std::endl;
+    std::cout << "  --list                  List the selected tests and exit" << std::endl;
+    std::cout << "  --profile[=DIR]         Sample call stacks and write DIR/<test>.folded (default DIR: profiles)" << std::endl;
+    std::cout << "  --repeat=K              Run every test K times (in parallel with --jobs) and flag flaky and noisy tests" << std::endl;
+    std::cout << "  --max-cv=F              Duration coefficient of variation above which --repeat flags a test as noisy (default 0.25)" << std::endl;
+    std::cout << "  --quarantine=FILE       Failures of the listed tests do not fail the run; --repeat updates the list" << std::endl;
+    std::cout << "  --timeout=SECONDS       Per-test time limit (0 = none); --isolate kills the test, otherwise the run aborts" << std::endl;
+    std::cout << "  --global-timeout=SECONDS  Abort the whole run after SECONDS, reporting running tests as TIMEOUT" << std::endl;
+    std::cout << "  --report-jsonl=FILE     Stream a JSON Lines record per test to FILE" << std::endl;
+    std::cout << "  --report-junit=FILE     Stream a JUnit XML report to FILE" << std::endl;
+    std::cout << "  --trace=FILE            Write a Chrome trace-event timeline of the run to FILE" << std::endl;
+    std::cout << "  --profile-hz N          Profiler sampling rate (default 1000)" << std::endl;
+    std::cout << "  --no-perf-counters      Do not read hardware performance counters" << std::endl;
+    std::cout << "  --timer=steady|tsc      Clock for test durations (default steady_clock)" << std::endl;
+    std::cout << "  --bench-samples N       Measured batches per benchmark (default 30)" << std::endl;
+    std::cout << "  --bench-time MS         Target duration of one benchmark batch (default 5)" << std::endl;
+    std::cout << "  --benchmarks-only       Run only BENCHMARK()s" << std::endl;
+    std::cout << "  --bench-baseline PATH   Fail benchmarks that are significantly slower than this baseline" << std::endl;
+    std::cout << "  --bench-save-baseline PATH  Record this run's benchmark samples as the baseline" << std::endl;
+    std::cout << "  --bench-max-slowdown PCT    Slowdown tolerated before a benchmark fails (default 10)" << std::endl;
+    std::cout << "  --bench-alpha P         Significance level of the slowdown test (default 0.01)" << std::endl;
+    std::cout << "  --bench-isolate         Pin benchmarks to one core, raise their priority, spin the core up" << std::endl;
+    std::cout << "                          first and report whether the machine was quiet (Linux)" << std::endl;
+    std::cout << "  --bench-cpu N           Core for --bench-isolate (default: the last one allowed)" << std::endl;
+    std::cout << "  -v, --verbose           Print every assertion, not just the output of failing tests" << std::endl;
+    std::cout << "  --filter=GLOBS          Run only tests matching one of the ':'-separated globs" << std::endl;
+    std::cout << "  --exclude=GLOBS         Skip tests matching one of the ':'-separated globs" << std::endl;
+    std::cout << "  --suite=NAMES           Run only the ','-separated suites (bootgen_all_tests)" << std::endl;
+    std::cout << "  --list-suites           List the suites linked into this binary and exit" << std::endl;
+    std::cout << "  -h, --help              Show this help message" << std::endl;
+}
+
+void invalid_option_value(const std::string& arg, const char* value) {
+    std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+    std::exit(2);
+}
+
+RunOptions parse_run_options(int argc, char* argv[]) {
+    RunOptions options;
+    env_unsigned("BOOTGEN_TEST_JOBS", options.jobs);
+    options.isolate = env_flag_set("BOOTGEN_TEST_ISOLATE");
+    options.verbose = env_flag_set("BOOTGEN_TEST_VERBOSE");
+    options.benchIsolate = env_flag_set("BOOTGEN_TEST_BENCH_ISOLATE");
+    const char* timer = std::getenv("BOOTGEN_TEST_TIMER");
+    env_unsigned("BOOTGEN_TEST_SHARD_INDEX", options.shardIndex);
+    env_unsigned("BOOTGEN_TEST_SHARD_COUNT", options.shardCount);
+    options.history = !env_flag_set("BOOTGEN_TEST_NO_HISTORY");
+    if (const char* store = std::getenv("BOOTGEN_TEST_HISTORY_STORE")) {
+        options.historyStore = store;
+    }
+    if (const char* commit = std::getenv("BOOTGEN_TEST_COMMIT")) {
+        options.commit = commit;
+    }
+    if (const char* durations = std::getenv("BOOTGEN_TEST_DURATIONS")) {
+        options.durationsFile = durations;
+    }
+    if (const char* filter = std::getenv("BOOTGEN_TEST_FILTER")) {
+        options.filter = filter;
+    }
+    if (const char* profile = std::getenv("BOOTGEN_TEST_PROFILE")) {
+        options.profileDir = profile;
+    }
+    if (const char* trace = std::getenv("BOOTGEN_TEST_TRACE")) {
+        options.traceFile = trace;
+    }
+    env_unsigned("BOOTGEN_TEST_REPEAT", options.repeat);
+    if (options.repeat == 0) options.repeat = 1;
+    if (const char* quarantine = std::getenv("BOOTGEN_TEST_QUARANTINE")) {
+        options.quarantineFile = quarantine;
+    }
+    env_double("BOOTGEN_TEST_TIMEOUT", options.timeoutSeconds);
+    env_double("BOOTGEN_TEST_GLOBAL_TIMEOUT", options.globalTimeoutSeconds);
+    if (const char* jsonl = std::getenv("BOOTGEN_TEST_REPORT_JSONL")) {
+        options.jsonlReport = jsonl;
+    }
+    if (const char* junit = std::getenv("BOOTGEN_TEST_REPORT_JUNIT")) {
+        options.junitReport = junit;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = nullptr;
+
+        if (match_option(arg, "--jobs", i, argc, argv, value) || match_option(arg, "-j", i, argc, argv, value)) {
+            if (!parse_unsigned(value, options.jobs)) invalid_option_value(arg, value);
+        } else if (arg.compare(0, 2, "-j") == 0 && arg.size() > 2) {
+            if (!parse_unsigned(argv[i] + 2, options.jobs)) invalid_option_value(arg, argv[i] + 2);
+        } else if (arg == "--isolate") {
+            options.isolate = true;
+        } else if (match_option(arg, "--shard-index", i, argc, argv, value)) {
+            if (!parse_unsigned(value, options.shardIndex)) invalid_option_value(arg, value);
+        } else if (match_option(arg, "--shard-count", i, argc, argv, value)) {
+            if (!parse_unsigned(value, options.shardCount)) invalid_option_value(arg, value);
+        } else if (match_option(arg, "--durations-file", i, argc, argv, value)) {
+            options.durationsFile = value;
+        } else if (match_option(arg, "--history-store", i, argc, argv, value)) {
+            options.historyStore = value;
+        } else if (match_option(arg, "--commit", i, argc, argv, value)) {
+            options.commit = value;
+        } else if (arg == "--no-history") {
+            options.history = false;
+        } else if (match_option(arg, "--filter", i, argc, argv, value)) {
+            options.filter = value;
+        } else if (match_option(arg, "--exclude", i, argc, argv, value)) {
+            options.exclude = value;
+        } else if (arg == "--list") {
+            options.list = true;
+        } else if (match_option(arg, "--bench-samples", i, argc, argv, value)) {
+            if (!parse_unsigned(value, options.benchSamples) || options.benchSamples == 0) invalid_option_value(arg, value);
+        } else if (match_option(arg, "--bench-time", i, argc, argv, value)) {
+            if (!parse_unsigned(value, options.benchTimeMs) || options.benchTimeMs == 0) invalid_option_value(arg, value);
+        } else if (arg == "--profile") {
+            options.profileDir = "profiles";
+        } else if (match_option(arg, "--profile", i, argc, argv, value)) {
+            if (!*value) invalid_option_value(arg, value);
+            options.profileDir = value;
+        } else if (match_option(arg, "--repeat", i, argc, argv, value)) {
+            if (!parse_unsigned(value, options.repeat) || options.repeat == 0) invalid_option_value(arg, value);
+        } else if (match_option(arg, "--max-cv", i, argc, argv, value)) {
+            if (!parse_double(value, options.maxCv)) invalid_option_value(arg, value);
+        } else if (match_option(arg, "--quarantine", i, argc, argv, value)) {
+            options.quarantineFile = value;
+        } else if (match_option(arg, "--timeout", i, argc, argv, value)) {
+            if (!parse_double(value, options.timeoutSeconds)) invalid_option_value(arg, value);
+        } else if (match_option(arg, "--global-timeout", i, argc, argv, value)) {
+            if (!parse_double(value, options.globalTimeoutSeconds)) invalid_option_value(arg, value);
+        } else if (match_option(arg, "--report-jsonl", i, argc, argv, value)) {
+            if (!*value) invalid_option_value(arg, value);
+            options.jsonlReport = value;
+        } else if (match_option(arg, "--report-junit", i, argc, argv, value)) {
+            if (!*value) invalid_option_value(arg, value);
+            options.junitReport = value;
+        } else if (match_option(arg, "--trace", i, argc, argv, value)) {
+            if (!*value) invalid_option_value(arg, value);
+            options.traceFile = value;
+        } else if (match_option(arg, "--profile-hz", i, argc, argv, value)) {
+            if (!parse_unsigned(value, options.profileHz) || options.profileHz == 0) invalid_option_value(arg, value);
+        } else if (arg == "--no-perf-counters") {
+            options.perfCounters = false;
+        } else if (arg == "--benchmarks-only") {
+            options.benchmarksOnly = true;
+        } else if (match_option(arg, "--bench-baseline", i, argc, argv, value)) {
+            options.benchBaseline = value;
+        } else if (match_option(arg, "--bench-save-baseline", i, argc, argv, value)) {
+            options.benchSaveBaseline = value;
+        } else if (match_option(arg, "--bench-max-slowdown", i, argc, argv, value)) {
+            if (!parse_double(value, options.benchMaxSlowdown)) invalid_option_value(arg, value);
+        } else if (match_option(arg, "--bench-alpha", i, argc, argv, value)) {
+            if (!parse_double(value, options.benchAlpha) || options.benchAlpha >= 1) invalid_option_value(arg, value);
+        } else if (arg == "--bench-isolate") {
+            options.benchIsolate = true;
+        } else if (match_option(arg, "--bench-cpu", i, argc, argv, value)) {
+            unsigned cpu;
+            if (!parse_unsigned(value, cpu)) invalid_option_value(arg, value);
+            options.benchCpu = static_cast<int>(cpu);
+            options.benchIsolate = true;
+        } else if (match_option(arg, "--timer", i, argc, argv, value)) {
+            timer = value;
+        } else if (arg == "--verbose" || arg == "-v") {
+            options.verbose = true;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            std::exit(0);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            std::exit(2);
+        }
+    }
+
+    if (timer && *timer) {
+        if (std::strcmp(timer, "tsc") == 0) {
+            options.tscTimer = true;
+        } else if (std::strcmp(timer, "steady") != 0) {
+            invalid_option_value("--timer", timer);
+        }
+    }
+    if (options.jobs == 0) {
+        options.jobs = std::thread::hardware_concurrency();
+        if (options.jobs == 0) options.jobs = 1;
+    }
+    if (options.shardCount == 0 || options.shardIndex >= options.shardCount) {
+        std::cerr << "Shard index " << options.shardIndex << " is out of range for "
+                  << options.shardCount << " shard(s)" << std::endl;
+        std::exit(2);
+    }
+    return options;
+}
+
+// Shell-style glob supporting '*' and '?'
+bool glob_match(const char* pattern, const char* text) {
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*text) {
+        if (*pattern == '?' || *pattern == *text) {
+            pattern++;
+            text++;
+        } else if (*pattern == '*') {
+            star = pattern++;
+            resume = text;
+        } else if (star) {
+            pattern = star + 1;
+            text = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
+
+bool matches_any(const std::string& patterns, const std::string& name) {
+    size_t start = 0;
+    while (start <= patterns.size()) {
+        size_t end = patterns.find(':', start);
+        if (end == std::string::npos) end = patterns.size();
+        if (end > start && glob_match(patterns.substr(start, end - start).c_str(), name.c_str())) {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+std::vector<size_t> filter_tests(const std::vector<RegisteredTest>& tests, const RunOptions& options) {
+    std::vector<size_t> selected;
+    for (size_t i = 0; i < tests.size(); ++i) {
+        if (!options.filter.empty() && !matches_any(options.filter, tests[i].name)) continue;
+        if (!options.exclude.empty() && matches_any(options.exclude, tests[i].name)) continue;
+        if (options.benchmarksOnly && !tests[i].benchmark) continue;
+        selected.push_back(i);
+    }
+    return selected;
+}
+
+// Duration history: one "<test name>\t<milliseconds>" line per test. Later lines
+// win, so files written by different shards can simply be concatenated. Each
+// run folds its timings in as an exponentially weighted moving average, which
+// follows a test that really got slower within a few runs without letting one
+// noisy run reorder the schedule.
+const double kHistoryWeight = 0.3;      // Weight of the newest run
+
+void update_test_duration(std::map<std::string, double>& durations, const std::string& name, double milliseconds) {
+    auto known = durations.find(name);
+    if (known == durations.end()) {
+        durations[name] = milliseconds;
+    } else {
+        known->second = kHistoryWeight * milliseconds + (1.0 - kHistoryWeight) * known->second;
+    }
+}
+
+std::map<std::string, double> load_test_durations(const std::string& path) {
+    std::map<std::string, double> durations;
+    std::ifstream in(path.c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t tab = line.rfind('\t');
+        if (tab == std::string::npos) continue;
+        char* end = nullptr;
+        double value = std::strtod(line.c_str() + tab + 1, &end);
+        if (end != line.c_str() + tab + 1 && value >= 0) {
+            durations[line.substr(0, tab)] = value;
+        }
+    }
+    return durations;
+}
+
+void save_test_durations(const std::string& path, const std::map<std::string, double>& durations) {
+    // Write a sibling file and rename it so readers never see a partial history
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp.c_str());
+        if (!out.is_open()) {
+            std::cerr << "Failed to write test durations file: " << path << std::endl;
+            return;
+        }
+        for (const auto& entry : durations) {
+            out << entry.first << '\t' << entry.second << '\n';
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace test durations file: " << path << std::endl;
+        std::remove(temp.c_str());
+    }
+}
+
+// Benchmark baseline: "<benchmark>\t<iterations>\t<ns per iteration>..." with
+// the samples separated by spaces. Later lines win, as for durations.
+std::map<std::string, std::vector<double> > load_benchmark_baseline(const std::string& path) {
+    std::map<std::string, std::vector<double> > baseline;
+    std::ifstream in(path.c_str());
+    if (!in.is_open()) {
+        std::cerr << "Benchmark baseline not found: " << path << " (no comparisons will be made)" << std::endl;
+        return baseline;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t name_end = line.find('\t');
+        size_t samples_start = name_end == std::string::npos ? name_end : line.find('\t', name_end + 1);
+        if (samples_start == std::string::npos) continue;
+        std::istringstream values(line.substr(samples_start + 1));
+        std::vector<double> samples;
+        double sample;
+        while (values >> sample) {
+            samples.push_back(sample);
+        }
+        if (!samples.empty()) {
+            baseline[line.substr(0, name_end)].swap(samples);
+        }
+    }
+    return baseline;
+}
+
+// Replaces the entries of the benchmarks that ran and keeps the others
+void save_benchmark_baseline(const std::string& path, const std::vector<TestResult>& results) {
+    std::map<std::string, std::string> lines;
+    {
+        std::ifstream in(path.c_str());
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t tab = line.find('\t');
+            if (line.empty() || line[0] == '#' || tab == std::string::npos) continue;
+            lines[line.substr(0, tab)] = line;
+        }
+    }
+    for (const auto& result : results) {
+        if (result.benchmarkSamples.empty() || !result.passed) continue;
+        std::ostringstream line;
+        line << result.testName << '\t' << result.benchmarkIterations << '\t';
+        for (size_t i = 0; i < result.benchmarkSamples.size(); ++i) {
+            line << (i ? " " : "") << result.benchmarkSamples[i];
+        }
+        lines[result.testName] = line.str();
+    }
+
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp.c_str());
+        if (!out.is_open()) {
+            std::cerr << "Failed to write benchmark baseline: " << path << std::endl;
+            return;
+        }
+        out << "# <benchmark>\t<iterations per sample>\t<ns per iteration, one value per sample>\n";
+        for (const auto& entry : lines) {
+            out << entry.second << '\n';
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace benchmark baseline: " << path << std::endl;
+        std::remove(temp.c_str());
+    }
+}
+
+// (duration, test index) pairs, heaviest first; ties go by name so every
+// process orders them alike. Tests without history weigh as much as the
+// average known test.
+std::vector<std::pair<double, size_t> > weigh_by_duration(const std::vector<RegisteredTest>& tests,
+                                                          const std::vector<size_t>& candidates,
+                                                          const std::map<std::string, double>& durations) {
+    double known_total = 0.0;
+    size_t known_count = 0;
+    for (size_t index : candidates) {
+        auto it = durations.find(tests[index].name);
+        if (it != durations.end()) {
+            known_total += it->second;
+            known_count++;
+        }
+    }
+    double default_weight = known_count > 0 ? known_total / known_count : 1.0;
+
+    std::vector<std::pair<double, size_t> > weighted;
+    for (size_t index : candidates) {
+        auto it = durations.find(tests[index].name);
+        weighted.push_back(std::make_pair(it != durations.end() ? it->second : default_weight, index));
+    }
+    std::stable_sort(weighted.begin(), weighted.end(),
+                     [&tests](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) {
+                         if (a.first != b.first) return a.first > b.first;
+                         return tests[a.second].name < tests[b.second].name;
+                     });
+    return weighted;
+}
+
+// Deterministically picks the tests belonging to this shard. Tests are taken
+// heaviest first and each goes to the currently lightest shard (ties: fewest
+// tests, then lowest index), so every process computes the same split as long
+// as it sees the same test list and durations file.
+std::vector<size_t> select_shard(const std::vector<RegisteredTest>& tests, const std::vector<size_t>& candidates,
+                                 const RunOptions& options, const std::map<std::string, double>& durations) {
+    if (options.shardCount <= 1) {
+        return candidates;
+    }
+
+    std::vector<std::pair<double, size_t> > weighted = weigh_by_duration(tests, candidates, durations);
+    std::vector<size_t> selected;
+    std::vector<double> load(options.shardCount, 0.0);
+    std::vector<size_t> count(options.shardCount, 0);
+    for (const auto& item : weighted) {
+        unsigned target = 0;
+        for (unsigned shard = 1; shard < options.shardCount; ++shard) {
+            if (load[shard] < load[target] || (load[shard] == load[target] && count[shard] < count[target])) {
+                target = shard;
+            }
+        }
+        load[target] += item.first;
+        count[target]++;
+        if (target == options.shardIndex) {
+            selected.push_back(item.second);
+        }
+    }
+
+    // Run the shard's tests in registration order
+    std::sort(selected.begin(), selected.end());
+    return selected;
+}
+
+// Longest-processing-time-first: tests go heaviest first to the queue with the
+// least expected work, so every worker starts on its longest tests and the
+// short ones are left at the back for idle workers to steal. Without this a
+// slow test queued last sets the wall-clock time on its own. The runs of a
+// repeated test ('jobs' per test) land on different workers where possible.
+void schedule_longest_first(const std::vector<RegisteredTest>& tests, const std::vector<size_t>& plain,
+                            const std::map<std::string, double>& durations,
+                            const std::vector<std::vector<size_t> >& jobs, std::vector<WorkQueue>& queues) {
+    std::vector<double> load(queues.size(), 0.0);
+    for (const auto& item : weigh_by_duration(tests, plain, durations)) {
+        for (size_t job : jobs[item.second]) {
+            size_t target = std::min_element(load.begin(), load.end()) - load.begin();
+            load[target] += item.first;
+            queues[target].push(job);
+        }
+    }
+}
+
+std::string current_commit() {
+    std::string commit;
+#ifndef _WIN32
+    if (FILE* git = ::popen("git rev-parse --short HEAD 2>/dev/null", "r")) {
+        char line[128];
+        if (std::fgets(line, sizeof(line), git)) commit = line;
+        ::pclose(git);
+    }
+#endif
+    while (!commit.empty() && (commit.back() == '\n' || commit.back() == '\r')) commit.pop_back();
+    return commit.empty() ? "unknown" : commit;
+}
+
+// One history record per (test, metric). Crashed and timed-out tests are left
+// out: their durations say nothing about the code's speed.
+void append_performance_history(const RunOptions& options, const std::vector<TestResult>& results) {
+    std::vector<perf_history::Measurement> measurements;
+    for (const TestResult& result : results) {
+        if (result.status != TestStatus::Passed && result.status != TestStatus::Failed) continue;
+        auto add = [&measurements, &result](const char* metric, double value) {
+            perf_history::Measurement measurement = { result.testName, metric, value };
+            measurements.push_back(measurement);
+        };
+        add("duration_ns", static_cast<double>(result.duration.count()));
+        if (kAllocationHooks) {
+            add("allocations", static_cast<double>(result.allocations));
+            add("peak_live_bytes", static_cast<double>(result.peakLiveBytes));
+        }
+        if (result.counters.instructions >= 0) add("instructions", static_cast<double>(result.counters.instructions));
+        if (!result.benchmarkSamples.empty()) {
+            SampleSummary summary = summarize_samples(result.benchmarkSamples);
+            add("bench_median_ns", summary.median);
+            add("bench_mad_ns", summary.mad);
+        }
+    }
+    const std::string commit = options.commit.empty() ? current_commit() : options.commit;
+#ifndef _WIN32
+    if (!perf_history::append_run(options.historyStore, commit, static_cast<int64_t>(std::time(nullptr)), measurements)) {
+        std::cerr << "Failed to append to performance history " << options.historyStore << ": "
+                  << std::strerror(errno) << std::endl;
+        return;
+    }
+    std::cout << "Performance history: " << measurements.size() << " records for " << commit << " appended to "
+              << options.historyStore << std::endl;
+#else
+    std::cout << "Performance history is not supported on this platform; ignoring --history-store" << std::endl;
+#endif
+}
+
+std::chrono::nanoseconds run_benchmark_batch(const RegisteredTest& test, uint64_t iterations,
+                                             uint64_t& allocations) {
+    BenchmarkState state(iterations);
+    uint64_t allocations_before = t_allocations.allocations;
+    // Millions of identical TRACE_SCOPE spans would swamp the timeline
+    t_trace_muted = true;
+    try {
+        test.benchmark(state);
+    } catch (...) {
+        t_trace_muted = false;
+        throw;
+    }
+    t_trace_muted = false;
+    allocations += t_allocations.allocations - allocations_before;
+    if (!state.finished()) {
+        throw std::runtime_error("Benchmark body must loop on state.KeepRunning() until it returns false");
+    }
+    return state.elapsed();
+}
+
+std::string format_benchmark_line(const TestResult& result) {
+    SampleSummary summary = summarize_samples(result.benchmarkSamples);
+    std::ostringstream line;
+    line << "[BENCH] median " << format_nanoseconds(summary.median)
+         << ", p90 " << format_nanoseconds(summary.p90)
+         << ", p99 " << format_nanoseconds(summary.p99)
+         << ", MAD " << format_nanoseconds(summary.mad)
+         << " per iteration (" << summary.count << " samples x " << result.benchmarkIterations << " iterations)";
+    if (kAllocationHooks && result.benchmarkIterations > 0 && !result.benchmarkSamples.empty()) {
+        line << ", " << std::fixed << std::setprecision(2)
+             << static_cast<double>(result.benchmarkAllocations) /
+                (static_cast<double>(result.benchmarkIterations) * static_cast<double>(result.benchmarkSamples.size()))
+             << " allocs/iteration";
+    }
+    line << "\n";
+    return line.str();
+}
+
+#ifdef TEST_HAVE_BENCH_ISOLATION
+// Set up for one benchmark under --bench-isolate and undone afterwards: the
+// calling thread is pinned to one core and its nice value lowered as far as
+// the process may, then a fixed busy loop is timed until its speed stops
+// changing, so the core has left its idle clock before calibration starts.
+// While the benchmark measures, the run queue is watched from two sides: the
+// threads /proc/loadavg lists as runnable, and the time the benchmark thread
+// itself spent runnable but waiting for its core (schedstat). The machine
+// counts as quiet when that wait stayed under 1% of the measurement, fewer
+// other threads than cores were runnable on average, and the load average
+// did not exceed the core count.
+class BenchIsolation {
+public:
+    BenchIsolation(const RunOptions& options, BenchEnvironment& environment) : env_(environment) {
+        const pid_t thread = static_cast<pid_t>(::syscall(SYS_gettid));
+        env_.recorded = true;
+        env_.cpus = static_cast<unsigned>(std::max(1L, ::sysconf(_SC_NPROCESSORS_ONLN)));
+
+        pinned_ = ::sched_getaffinity(0, sizeof(previousMask_), &previousMask_) == 0;
+        int cpu = options.benchCpu;
+        for (int k = CPU_SETSIZE - 1; cpu < 0 && pinned_ && k >= 0; --k) {
+            if (CPU_ISSET(k, &previousMask_)) cpu = k;     // Core 0 usually takes the most interrupts
+        }
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &mask);
+        pinned_ = pinned_ && cpu >= 0 && cpu < CPU_SETSIZE && ::sched_setaffinity(0, sizeof(mask), &mask) == 0;
+        env_.cpu = pinned_ ? cpu : -1;
+
+        // Without CAP_SYS_NICE only RLIMIT_NICE allows going below the current value
+        errno = 0;
+        previousNice_ = ::getpriority(PRIO_PROCESS, static_cast<id_t>(thread));
+        const bool known = errno == 0;
+        env_.niceness = known ? previousNice_ : 0;
+        for (int nice = -20; known && nice < previousNice_; nice += 5) {
+            if (::setpriority(PRIO_PROCESS, static_cast<id_t>(thread), nice) == 0) {
+                env_.niceness = nice;
+                reniced_ = true;
+                break;
+            }
+        }
+        spin_up();
+    }
+
+    ~BenchIsolation() {
+        if (reniced_) {
+            ::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), previousNice_);
+        }
+        if (pinned_) ::sched_setaffinity(0, sizeof(previousMask_), &previousMask_);
+    }
+
+    void start_measuring() {
+        startWait_ = read_wait_ns();
+        startTime_ = std::chrono::steady_clock::now();
+    }
+
+    // Between measured batches
+    void sample() {
+        int running = read_running_threads();
+        if (running < 0) return;
+        runnableTotal_ += running - 1;  // The reading thread counts itself
+        runnableSamples_++;
+    }
+
+    void finish_measuring() {
+        const double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - startTime_).count());
+        const int64_t wait = read_wait_ns();
+        if (wait >= 0 && startWait_ >= 0 && elapsed > 0) {
+            env_.runQueueWait = static_cast<double>(wait - startWait_) / elapsed;
+        }
+        if (runnableSamples_ > 0) env_.otherRunnable = runnableTotal_ / runnableSamples_;
+        double load[1];
+        if (::getloadavg(load, 1) == 1) env_.loadAverage = load[0];
+        env_.quiet = env_.runQueueWait < kMaxRunQueueWait && env_.otherRunnable < env_.cpus &&
+                     env_.loadAverage <= env_.cpus;
+    }
+
+private:
+    static constexpr double kMaxRunQueueWait = 0.01;
+
+    void spin_up() {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point start = Clock::now();
+        const auto minimum = std::chrono::milliseconds(100);
+        const auto cap = std::chrono::seconds(1);
+        std::deque<double> recent;      // Durations of the latest rounds of the loop
+        uint64_t state = 88172645463325252ull;
+        for (;;) {
+            Clock::time_point round = Clock::now();
+            for (int k = 0; k < 100000; ++k) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+            }
+            const Clock::time_point now = Clock::now();
+            recent.push_back(static_cast<double>((now - round).count()));
+            if (recent.size() > 8) recent.pop_front();
+            if (now - start >= minimum && recent.size() == 8 &&
+                *std::max_element(recent.begin(), recent.end()) <=
+                    1.02 * *std::min_element(recent.begin(), recent.end())) {
+                env_.spinUpSteady = true;
+                break;
+            }
+            if (now - start >= cap) break;
+        }
+        g_benchmark_sink = reinterpret_cast<const void*>(static_cast<uintptr_t>(state));
+        env_.spinUpMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Nanoseconds the calling thread has spent runnable but not running; -1 if unknown
+    static int64_t read_wait_ns() {
+        std::ifstream schedstat("/proc/thread-self/schedstat");
+        int64_t running = 0, waiting = -1;
+        if (!(schedstat >> running >> waiting)) return -1;
+        return waiting;
+    }
+
+    // Fourth field of /proc/loadavg: "<runnable>/<total>" scheduling entities
+    static int read_running_threads() {
+        std::ifstream loadavg("/proc/loadavg");
+        double averages[3];
+        int running = -1;
+        if (!(loadavg >> averages[0] >> averages[1] >> averages[2] >> running)) return -1;
+        return running;
+    }
+
+    BenchEnvironment& env_;
+    cpu_set_t previousMask_;
+    bool pinned_ = false;
+    int previousNice_ = 0;
+    bool reniced_ = false;
+    int64_t startWait_ = -1;
+    std::chrono::steady_clock::time_point startTime_;
+    double runnableTotal_ = 0.0;
+    unsigned runnableSamples_ = 0;
+};
+#endif
+
+std::string format_bench_environment(const BenchEnvironment& env) {
+    std::ostringstream line;
+    if (env.cpu >= 0) {
+        line << "CPU " << env.cpu;
+    } else {
+        line << "not pinned";
+    }
+    line << ", nice " << env.niceness << ", spin-up " << std::fixed << std::setprecision(0) << env.spinUpMs << " ms"
+         << (env.spinUpSteady ? "" : " (clock still changing)") << "; load " << std::setprecision(2)
+         << env.loadAverage << " on " << env.cpus << " core" << (env.cpus == 1 ? "" : "s") << ", "
+         << std::setprecision(1) << env.otherRunnable << " other runnable threads, "
+         << env.runQueueWait * 100.0 << "% run-queue wait: " << (env.quiet ? "quiet" : "BUSY");
+    return line.str();
+}
+
+// Warm-up doubles as calibration: the batch size grows until one batch takes
+// the target sample time and at least ten sample times have been spent, so
+// caches, branch predictors and the allocator are hot before measuring.
+void run_benchmark(const RegisteredTest& test, TestResult& result) {
+#ifdef TEST_HAVE_BENCH_ISOLATION
+    std::unique_ptr<BenchIsolation> isolation;
+    if (g_run_options.benchIsolate) {
+        uint64_t isolate_start = trace_start();
+        isolation.reset(new BenchIsolation(g_run_options, result.benchEnvironment));
+        trace_end("spin-up", "phase", isolate_start);
+    }
+#endif
+    const std::chrono::nanoseconds target = std::chrono::milliseconds(g_run_options.benchTimeMs);
+    const std::chrono::nanoseconds warmup = target * 10;
+    const uint64_t max_iterations = 1000000000ull;
+
+    uint64_t iterations = 1;
+    uint64_t warmup_allocations = 0;
+    std::chrono::nanoseconds spent(0);
+    uint64_t calibrate_start = trace_start();
+    for (;;) {
+        std::chrono::nanoseconds elapsed = run_benchmark_batch(test, iterations, warmup_allocations);
+        spent += elapsed;
+        if (elapsed >= target || iterations >= max_iterations) {
+            if (spent >= warmup) break;
+            continue;
+        }
+        // Aim 20% past the target, growing by at most 10x per step
+        double scale = elapsed.count() > 0
+            ? 1.2 * static_cast<double>(target.count()) / static_cast<double>(elapsed.count())
+            : 10.0;
+        scale = std::min(scale, 10.0);
+        uint64_t next = static_cast<uint64_t>(static_cast<double>(iterations) * scale);
+        iterations = std::min(std::max(next, iterations + 1), max_iterations);
+    }
+
+    trace_end("calibrate", "phase", calibrate_start);
+
+    uint64_t measure_start = trace_start();
+    result.benchmarkIterations = iterations;
+    result.benchmarkAllocations = 0;
+    result.benchmarkSamples.clear();
+    result.benchmarkSamples.reserve(g_run_options.benchSamples);
+#ifdef TEST_HAVE_BENCH_ISOLATION
+    if (isolation) isolation->start_measuring();
+#endif
+    for (unsigned sample = 0; sample < g_run_options.benchSamples; ++sample) {
+        std::chrono::nanoseconds elapsed = run_benchmark_batch(test, iterations, result.benchmarkAllocations);
+        result.benchmarkSamples.push_back(static_cast<double>(elapsed.count()) / static_cast<double>(iterations));
+#ifdef TEST_HAVE_BENCH_ISOLATION
+        if (isolation) isolation->sample();
+#endif
+    }
+#ifdef TEST_HAVE_BENCH_ISOLATION
+    if (isolation) isolation->finish_measuring();
+#endif
+    trace_end("measure", "phase", measure_start);
+    t_log.keep(format_benchmark_line(result));
+    if (result.benchEnvironment.recorded) {
+        t_log.keep("[ISOLATE] " + format_bench_environment(result.benchEnvironment) + "\n");
+    }
+}
+
+// A benchmark regresses when its samples are significantly larger than the
+// baseline samples inflated by the tolerated slowdown (one-sided
+// Mann-Whitney U), so noise and small drifts do not fail the run.
+void check_benchmark_baseline(const RegisteredTest& test, TestResult& result) {
+    auto it = g_benchmark_baseline.find(test.name);
+    if (it == g_benchmark_baseline.end()) {
+        if (!g_run_options.benchBaseline.empty()) {
+            t_log.keep("[BASELINE] No baseline samples for this benchmark\n");
+        }
+        return;
+    }
+
+    const double tolerance = 1.0 + g_run_options.benchMaxSlowdown / 100.0;
+    std::vector<double> allowed(it->second);
+    for (double& sample : allowed) {
+        sample *= tolerance;
+    }
+    RankSumTest test_result = mann_whitney_greater(result.benchmarkSamples, allowed);
+    double current = median_of(result.benchmarkSamples);
+    double baseline = median_of(it->second);
+    double change = baseline > 0 ? (current / baseline - 1.0) * 100.0 : 0.0;
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1)
+         << "median " << format_nanoseconds(current) << " vs baseline " << format_nanoseconds(baseline)
+         << " (" << (change >= 0 ? "+" : "") << change << "%), p=" << std::setprecision(4) << test_result.pGreater
+         << " for a slowdown over " << std::setprecision(1) << g_run_options.benchMaxSlowdown << "%";
+    if (test_result.pGreater < g_run_options.benchAlpha) {
+        t_log.keep("[FAIL] Slower than baseline: " + line.str() + "\n");
+        result.errorMessage = "Slower than baseline: " + line.str();
+        record_assertion_failure(test.name);
+    } else {
+        t_log.keep("[BASELINE] " + line.str() + "\n");
+        record_assertion_pass();
+    }
+}
+
+void run_single_test(const RegisteredTest& test, TestOutcome& outcome) {
+    TestContext context;
+    context.testName = &test.name;
+    context.log = &t_log;
+    t_log.begin(g_run_options.verbose);
+    t_log.keep("\n=== Running: " + test.name + " ===\n");
+    context.trace = &outcome.trace;
+    t_context = &context;
+    uint64_t test_start = trace_start();
+
+    std::ostream& out = test_output();
+    PerfCounterGroup::Snapshot counters_before, counters_after;
+    bool counting = false;
+    if (g_run_options.perfCounters && t_perf_counters.ready()) {
+        test_internal::AllocationPause pause;
+        counting = t_perf_counters.read(counters_before);
+    }
+    // The RSS peak is process-wide, so it is only reset while no other test
+    // runs in this process: serial runs and isolated children
+    bool track_peak = false;
+    ResourceSample resources_before;
+    {
+        test_internal::AllocationPause pause;
+#ifdef TEST_HAVE_PROC_RESOURCES
+        if (g_run_options.jobs <= 1 || g_run_options.isolate) {
+            track_peak = reset_peak_rss();
+        }
+#endif
+        resources_before = sample_resources();
+    }
+    const AllocationCounters allocations_before = t_allocations;
+    t_allocations.peakLiveBytes = t_allocations.liveBytes;
+    trace_end("setup", "phase", test_start);
+    uint64_t body_start = trace_start();
+#ifdef TEST_HAVE_PROFILER
+    if (g_profiler_running) SamplingProfiler::begin_test();
+#endif
+    uint64_t start_time = g_timer.now();
+    try {
+        if (test.benchmark) {
+            run_benchmark(test, outcome.result);
+            check_benchmark_baseline(test, outcome.result);
+        } else {
+            test.func();
+        }
+    } catch (const std::exception& e) {
+        out << "[EXCEPTION] " << e.what() << '\n';
+        record_assertion_failure(test.name);
+    } catch (...) {
+        out << "[UNKNOWN EXCEPTION]" << '\n';
+        record_assertion_failure(test.name);
+    }
+    std::chrono::nanoseconds duration = g_timer.elapsed(start_time, g_timer.now());
+    const AllocationCounters allocations_after = t_allocations;
+    trace_end(test.benchmark ? "benchmark" : "body", "phase", body_start);
+    uint64_t teardown_start = trace_start();
+#ifdef TEST_HAVE_PROFILER
+    if (g_profiler_running) {
+        const void* entry = test.benchmark ? reinterpret_cast<const void*>(test.benchmark)
+                                           : reinterpret_cast<const void*>(test.func);
+        t_log.keep(SamplingProfiler::end_test(g_run_options.profileDir, test.name, entry));
+    }
+#endif
+    if (counting && t_perf_counters.read(counters_after)) {
+        t_perf_counters.difference(counters_before, counters_after, outcome.result.counters);
+    }
+    {
+        test_internal::AllocationPause pause;
+        ResourceSample resources_after = sample_resources();
+        if (resources_before.valid && resources_after.valid) {
+            ResourceUsage& usage = outcome.result.resources;
+            usage.available = true;
+            usage.rssDeltaBytes = resources_after.rssBytes - resources_before.rssBytes;
+            usage.minorFaults = resources_after.minorFaults - resources_before.minorFaults;
+            usage.majorFaults = resources_after.majorFaults - resources_before.majorFaults;
+            usage.voluntarySwitches = resources_after.voluntarySwitches - resources_before.voluntarySwitches;
+            usage.involuntarySwitches = resources_after.involuntarySwitches - resources_before.involuntarySwitches;
+#ifdef TEST_HAVE_PROC_RESOURCES
+            int64_t peak = track_peak ? read_peak_rss_bytes() : -1;
+            if (peak >= 0) {
+                usage.peakRssDeltaBytes = std::max<int64_t>(0, peak - resources_before.rssBytes);
+            }
+#endif
+        }
+    }
+    trace_end("teardown", "phase", teardown_start);
+    trace_end(test.name.c_str(), "test", test_start);
+    t_log.finish(outcome.output);
+    outcome.output += "Test completed in " + format_duration(duration) + "\n";
+
+    TestResult& result = outcome.result;
+    result.testName = test.name;
+    result.passed = (context.failed == 0);
+    result.status = result.passed ? TestStatus::Passed : TestStatus::Failed;
+    result.duration = duration;
+    result.assertionsPassed = context.passed;
+    result.assertionsFailed = context.failed;
+    result.allocations = allocations_after.allocations - allocations_before.allocations;
+    result.deallocations = allocations_after.frees - allocations_before.frees;
+    result.allocatedBytes = allocations_after.bytes - allocations_before.bytes;
+    result.peakLiveBytes = static_cast<uint64_t>(
+        std::max<int64_t>(0, allocations_after.peakLiveBytes - allocations_before.liveBytes));
+    if (!result.passed && result.errorMessage.empty()) {
+        result.errorMessage = "Test failed with assertions";
+    }
+    outcome.failedTests.swap(context.failedTests);
+    outcome.ran = true;
+
+    t_context = nullptr;
+}
+
+// Marks a test that never produced a result of its own (crash, lost worker)
+void record_abnormal_end(const RegisteredTest& test, TestStatus status, const std::string& message,
+                         std::chrono::nanoseconds duration, TestOutcome& outcome) {
+    TestResult& result = outcome.result;
+    result.testName = test.name;
+    result.passed = false;
+    result.status = status;
+    result.errorMessage = message;
+    result.duration = duration;
+    result.assertionsPassed = 0;
+    result.assertionsFailed = 1;
+    outcome.failedTests.assign(1, test.name);
+    outcome.ran = true;
+
+    std::ostringstream out;
+    out << "[" << test_status_name(status) << "] " << test.name << ": " << message << std::endl;
+    outcome.output += out.str();
+}
+
+#ifndef _WIN32
+
+// Fixed-layout serialisation used to ship a TestOutcome back over a pipe
+class ByteWriter {
+public:
+    void put_u32(uint32_t value) { data_.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void put_i64(int64_t value) { data_.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void put_f64(double value) { data_.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void put_string(const std::string& value) {
+        put_u32(static_cast<uint32_t>(value.size()));
+        data_.append(value);
+    }
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+};
+
+class ByteReader {
+public:
+    explicit ByteReader(const std::string& data) : data_(data) {}
+
+    bool get_u32(uint32_t& value) { return get_raw(&value, sizeof(value)); }
+    bool get_i64(int64_t& value) { return get_raw(&value, sizeof(value)); }
+    bool get_f64(double& value) { return get_raw(&value, sizeof(value)); }
+    bool get_string(std::string& value) {
+        uint32_t size;
+        if (!get_u32(size) || data_.size() - pos_ < size) return false;
+        value.assign(data_, pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+private:
+    bool get_raw(void* value, size_t size) {
+        if (data_.size() - pos_ < size) return false;
+        std::memcpy(value, data_.data() + pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+    const std::string& data_;
+    size_t pos_ = 0;
+};
+
+std::string serialize_outcome(const TestOutcome& outcome) {
+    const TestResult& result = outcome.result;
+    ByteWriter writer;
+    writer.put_string(result.testName);
+    writer.put_u32(static_cast<uint32_t>(result.status));
+    writer.put_string(result.errorMessage);
+    writer.put_i64(result.duration.count());
+    writer.put_u32(static_cast<uint32_t>(result.assertionsPassed));
+    writer.put_u32(static_cast<uint32_t>(result.assertionsFailed));
+    writer.put_u32(static_cast<uint32_t>(outcome.failedTests.size()));
+    for (const auto& name : outcome.failedTests) {
+        writer.put_string(name);
+    }
+    writer.put_string(outcome.output);
+    writer.put_i64(static_cast<int64_t>(result.allocations));
+    writer.put_i64(static_cast<int64_t>(result.deallocations));
+    writer.put_i64(static_cast<int64_t>(result.allocatedBytes));
+    writer.put_i64(static_cast<int64_t>(result.peakLiveBytes));
+    writer.put_i64(static_cast<int64_t>(result.benchmarkAllocations));
+    writer.put_i64(result.counters.cycles);
+    writer.put_i64(result.counters.instructions);
+    writer.put_i64(result.counters.l1dMisses);
+    writer.put_i64(result.counters.llcMisses);
+    writer.put_i64(result.counters.branchMisses);
+    writer.put_i64(result.resources.available ? 1 : 0);
+    writer.put_i64(result.resources.rssDeltaBytes);
+    writer.put_i64(result.resources.peakRssDeltaBytes);
+    writer.put_i64(result.resources.minorFaults);
+    writer.put_i64(result.resources.majorFaults);
+    writer.put_i64(result.resources.voluntarySwitches);
+    writer.put_i64(result.resources.involuntarySwitches);
+    writer.put_i64(static_cast<int64_t>(result.benchmarkIterations));
+    writer.put_u32(static_cast<uint32_t>(result.benchmarkSamples.size()));
+    for (double sample : result.benchmarkSamples) {
+        writer.put_f64(sample);
+    }
+    const BenchEnvironment& env = result.benchEnvironment;
+    writer.put_u32((env.recorded ? 1u : 0u) | (env.spinUpSteady ? 2u : 0u) | (env.quiet ? 4u : 0u));
+    writer.put_i64(env.cpu);
+    writer.put_i64(env.niceness);
+    writer.put_u32(env.cpus);
+    writer.put_f64(env.spinUpMs);
+    writer.put_f64(env.loadAverage);
+    writer.put_f64(env.otherRunnable);
+    writer.put_f64(env.runQueueWait);
+    writer.put_u32(static_cast<uint32_t>(outcome.trace.size()));
+    for (const auto& event : outcome.trace) {
+        writer.put_string(event.name);
+        writer.put_string(event.category);
+        writer.put_i64(static_cast<int64_t>(event.startNs));
+        writer.put_i64(static_cast<int64_t>(event.durationNs));
+    }
+    return writer.data();
+}
+
+bool deserialize_outcome(const std::string& data, TestOutcome& outcome) {
+    TestResult& result = outcome.result;
+    ByteReader reader(data);
+    uint32_t status, passed, failed, count;
+    int64_t duration;
+    if (!reader.get_string(result.testName) || !reader.get_u32(status) ||
+        !reader.get_string(result.errorMessage) || !reader.get_i64(duration) ||
+        !reader.get_u32(passed) || !reader.get_u32(failed) || !reader.get_u32(count)) {
+        return false;
+    }
+    outcome.failedTests.resize(count);
+    for (auto& name : outcome.failedTests) {
+        if (!reader.get_string(name)) return false;
+    }
+    if (!reader.get_string(outcome.output)) return false;
+    int64_t counts[17];
+    for (auto& count : counts) {
+        if (!reader.get_i64(count)) return false;
+    }
+    result.allocations = static_cast<uint64_t>(counts[0]);
+    result.deallocations = static_cast<uint64_t>(counts[1]);
+    result.allocatedBytes = static_cast<uint64_t>(counts[2]);
+    result.peakLiveBytes = static_cast<uint64_t>(counts[3]);
+    result.benchmarkAllocations = static_cast<uint64_t>(counts[4]);
+    result.counters.cycles = counts[5];
+    result.counters.instructions = counts[6];
+    result.counters.l1dMisses = counts[7];
+    result.counters.llcMisses = counts[8];
+    result.counters.branchMisses = counts[9];
+    result.resources.available = counts[10] != 0;
+    result.resources.rssDeltaBytes = counts[11];
+    result.resources.peakRssDeltaBytes = counts[12];
+    result.resources.minorFaults = counts[13];
+    result.resources.majorFaults = counts[14];
+    result.resources.voluntarySwitches = counts[15];
+    result.resources.involuntarySwitches = counts[16];
+
+    int64_t iterations;
+    uint32_t samples;
+    if (!reader.get_i64(iterations) || !reader.get_u32(samples)) return false;
+    result.benchmarkIterations = static_cast<uint64_t>(iterations);
+    result.benchmarkSamples.resize(samples);
+    for (auto& sample : result.benchmarkSamples) {
+        if (!reader.get_f64(sample)) return false;
+    }
+    BenchEnvironment& env = result.benchEnvironment;
+    uint32_t flags;
+    int64_t cpu, niceness;
+    if (!reader.get_u32(flags) || !reader.get_i64(cpu) || !reader.get_i64(niceness) || !reader.get_u32(env.cpus) ||
+        !reader.get_f64(env.spinUpMs) || !reader.get_f64(env.loadAverage) || !reader.get_f64(env.otherRunnable) ||
+        !reader.get_f64(env.runQueueWait)) {
+        return false;
+    }
+    env.recorded = (flags & 1u) != 0;
+    env.spinUpSteady = (flags & 2u) != 0;
+    env.quiet = (flags & 4u) != 0;
+    env.cpu = static_cast<int>(cpu);
+    env.niceness = static_cast<int>(niceness);
+    uint32_t spans;
+    if (!reader.get_u32(spans)) return false;
+    outcome.trace.resize(spans);
+    for (auto& event : outcome.trace) {
+        int64_t start, length;
+        if (!reader.get_string(event.name) || !reader.get_string(event.category) ||
+            !reader.get_i64(start) || !reader.get_i64(length)) {
+            return false;
+        }
+        event.startNs = static_cast<uint64_t>(start);
+        event.durationNs = static_cast<uint64_t>(length);
+    }
+
+    result.status = static_cast<TestStatus>(status);
+    result.passed = (result.status == TestStatus::Passed);
+    result.duration = std::chrono::nanoseconds(duration);
+    result.assertionsPassed = static_cast<int>(passed);
+    result.assertionsFailed = static_cast<int>(failed);
+    outcome.ran = true;
+    return true;
+}
+
+bool write_full(int fd, const void* buffer, size_t size) {
+    const char* data = static_cast<const char*>(buffer);
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool read_full(int fd, void* buffer, size_t size) {
+    char* data = static_cast<char*>(buffer);
+    while (size > 0) {
+        ssize_t got = ::read(fd, data, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+std::string read_to_eof(int fd) {
+    std::string data;
+    char chunk[4096];
+    for (;;) {
+        ssize_t got = ::read(fd, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        data.append(chunk, static_cast<size_t>(got));
+    }
+    return data;
+}
+
+// Timeouts. A watchdog thread holds a deadline per worker slot plus the
+// optional global deadline. A hung in-process test cannot be stopped from
+// outside its thread, so on expiry the watchdog prints the thread's
+// backtrace, streams a TIMEOUT record and ends the binary with exit code 124
+// so CI gets a report instead of a killed job. Isolated tests time out in
+// IsolationZygote::run instead: the child is killed and the run goes on.
+const int kTimeoutExitCode = 124;
+const int kBacktraceSignal = SIGUSR2;
+
+std::atomic<bool> g_backtrace_written{false};
+
+void write_backtrace_handler(int) {
+    int saved_errno = errno;
+#ifdef TEST_HAVE_BACKTRACE
+    void* frames[64];
+    int depth = ::backtrace(frames, 64);
+    ::backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+#endif
+    g_backtrace_written.store(true);
+    errno = saved_errno;
+}
+
+// Installed before the zygotes fork, so isolated children answer the signal too
+void install_backtrace_handler() {
+#ifdef TEST_HAVE_BACKTRACE
+    void* warm_up[4];
+    ::backtrace(warm_up, 4);    // Loads the unwinder outside the handler
+#endif
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = write_backtrace_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(kBacktraceSignal, &action, nullptr);
+}
+
+void print_thread_backtrace(pthread_t thread) {
+    g_backtrace_written.store(false);
+    if (::pthread_kill(thread, kBacktraceSignal) != 0) return;
+    auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!g_backtrace_written.load() && std::chrono::steady_clock::now() < give_up) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+// Asks an isolated child for its backtrace, then kills it
+void kill_test_process(pid_t child) {
+    ::kill(child, kBacktraceSignal);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ::kill(child, SIGKILL);
+}
+
+std::string format_seconds(double seconds) {
+    std::ostringstream text;
+    text << seconds << " s";
+    return text.str();
+}
+
+class Watchdog {
+public:
+    ~Watchdog() { stop(); }
+
+    void start(size_t slots, double globalSeconds) {
+        slots_.assign(slots, Slot());
+        if (globalSeconds > 0) {
+            globalSeconds_ = globalSeconds;
+            globalDeadline_ = std::chrono::steady_clock::now() + to_duration(globalSeconds);
+            hasGlobal_ = true;
+        }
+        thread_ = std::thread(&Watchdog::watch, this);
+    }
+
+    void stop() {
+        if (!thread_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+    bool running() const { return thread_.joinable(); }
+
+    // 'seconds' of 0 only guards the test with the global deadline
+    void arm(size_t slot, size_t test, double seconds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& entry = slots_[slot];
+        entry.active = true;
+        entry.test = test;
+        entry.thread = ::pthread_self();
+        entry.child = 0;
+        entry.start = std::chrono::steady_clock::now();
+        entry.hasDeadline = seconds > 0;
+        entry.seconds = seconds;
+        if (entry.hasDeadline) entry.deadline = entry.start + to_duration(seconds);
+        wake_.notify_all();
+    }
+
+    void set_child(size_t slot, pid_t child) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_[slot].child = child;
+    }
+
+    void disarm(size_t slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_[slot].active = false;
+        slots_[slot].child = 0;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Slot {
+        bool active = false;
+        size_t test = 0;
+        pthread_t thread = pthread_t();
+        pid_t child = 0;
+        Clock::time_point start;
+        bool hasDeadline = false;
+        double seconds = 0.0;
+        Clock::time_point deadline;
+    };
+
+    static Clock::duration to_duration(double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    void watch() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            Clock::time_point now = Clock::now();
+            Clock::time_point wake = Clock::time_point::max();
+            if (hasGlobal_) {
+                if (now >= globalDeadline_) {
+                    expire("global timeout of " + format_seconds(globalSeconds_) + " reached", nullptr);
+                }
+                wake = globalDeadline_;
+            }
+            for (Slot& entry : slots_) {
+                if (!entry.active || !entry.hasDeadline) continue;
+                if (now >= entry.deadline) {
+                    expire("exceeded its " + format_seconds(entry.seconds) + " timeout", &entry);
+                }
+                wake = std::min(wake, entry.deadline);
+            }
+            if (wake == Clock::time_point::max()) {
+                wake_.wait(lock);
+            } else {
+                wake_.wait_until(lock, wake);
+            }
+        }
+    }
+
+    // Reports every running test (or just 'culprit') as TIMEOUT and ends the process
+    void expire(const std::string& reason, Slot* culprit) {
+        test_internal::AllocationPause pause;
+        std::cout.flush();
+        for (Slot& entry : slots_) {
+            if (!entry.active || (culprit && &entry != culprit)) continue;
+            const RegisteredTest& test = registered_tests()[entry.test];
+            std::cerr << "[TIMEOUT] " << test.name << ": " << reason << std::endl;
+            if (entry.child > 0) {
+                std::cerr << "Backtrace of the test process " << entry.child << ":" << std::endl;
+                kill_test_process(entry.child);
+            } else {
+                std::cerr << "Backtrace of the test thread:" << std::endl;
+                print_thread_backtrace(entry.thread);
+            }
+            TestOutcome outcome;
+            record_abnormal_end(test, TestStatus::Timeout, reason + "; run aborted",
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - entry.start),
+                                outcome);
+            stream_outcome(test, outcome);
+            std::cout << outcome.output;
+        }
+        if (culprit) {
+            std::cout << "Aborting the run: a test thread cannot be stopped safely. Use --isolate to kill "
+                      << "timed-out tests and carry on." << std::endl;
+        } else {
+            std::cout << "Aborting the run: " << reason << "." << std::endl;
+        }
+        std::cerr.flush();
+        std::_Exit(kTimeoutExitCode);
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::thread thread_;
+    std::vector<Slot> slots_;
+    bool stopping_ = false;
+    bool hasGlobal_ = false;
+    double globalSeconds_ = 0.0;
+    Clock::time_point globalDeadline_;
+};
+
+// Waits until 'fd' is readable or the deadline passes; false on timeout
+bool wait_readable(int fd, std::chrono::steady_clock::time_point deadline) {
+    for (;;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) left = std::chrono::milliseconds(0);
+        struct pollfd entry;
+        entry.fd = fd;
+        entry.events = POLLIN;
+        entry.revents = 0;
+        int ready = ::poll(&entry, 1, static_cast<int>(std::min<int64_t>(left.count(), INT32_MAX)));
+        if (ready > 0) return true;
+        if (ready == 0) return false;
+        if (errno != EINTR) return true;    // Let the caller's read report the error
+    }
+}
+
+// A zygote is forked once, before any worker thread exists, so it is a warm,
+// single-threaded copy of the test binary. For every test it forks a child
+// that runs just that test and pipes the serialised outcome back; a crash
+// therefore only costs the child. Protocol on the command pipe: test index
+// (uint32). On the result pipe: the child's pid (0 if it could not be forked),
+// then wait status, payload size and the payload produced by the child.
+class IsolationZygote {
+public:
+    bool start() {
+        int command[2], result[2];
+        if (::pipe(command) != 0) return false;
+        if (::pipe(result) != 0) {
+            ::close(command[0]);
+            ::close(command[1]);
+            return false;
+        }
+
+        std::cout.flush();
+        pid_ = ::fork();
+        if (pid_ < 0) {
+            ::close(command[0]); ::close(command[1]);
+            ::close(result[0]); ::close(result[1]);
+            return false;
+        }
+        if (pid_ == 0) {
+            ::close(command[1]);
+            ::close(result[0]);
+            // Drop the pipe ends of zygotes forked earlier, or they never see EOF
+            for (int fd : parent_fds()) {
+                ::close(fd);
+            }
+            serve(command[0], result[1]);
+        }
+
+        ::close(command[0]);
+        ::close(result[1]);
+        commandFd_ = command[1];
+        resultFd_ = result[0];
+        parent_fds().push_back(commandFd_);
+        parent_fds().push_back(resultFd_);
+        return true;
+    }
+
+    // Returns false once the zygote itself is gone; a crashing or hung test is
+    // not an error here. A test still running after 'timeoutSeconds' is killed.
+    bool run(size_t index, TestOutcome& outcome, double timeoutSeconds, Watchdog& watchdog, size_t slot) {
+        const RegisteredTest& test = registered_tests()[index];
+        auto start_time = std::chrono::steady_clock::now();
+
+        uint32_t request = static_cast<uint32_t>(index);
+        uint32_t child = 0;
+        uint32_t header[2];
+        std::string payload;
+        bool timed_out = false;
+        bool connected = write_full(commandFd_, &request, sizeof(request)) &&
+                         read_full(resultFd_, &child, sizeof(child));
+        if (connected && child != 0) {
+            if (watchdog.running()) watchdog.set_child(slot, static_cast<pid_t>(child));
+            if (timeoutSeconds > 0) {
+                auto deadline = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(timeoutSeconds));
+                if (!wait_readable(resultFd_, deadline)) {
+                    timed_out = true;
+                    std::cerr << "[TIMEOUT] " << test.name << ": backtrace of the test process " << child << ":" << std::endl;
+                    kill_test_process(static_cast<pid_t>(child));
+                }
+            }
+        }
+        connected = connected && read_full(resultFd_, header, sizeof(header));
+        if (connected) {
+            payload.resize(header[1]);
+            connected = header[1] == 0 || read_full(resultFd_, &payload[0], header[1]);
+        }
+
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time);
+        if (!connected) {
+            record_abnormal_end(test, TestStatus::Crashed, "Lost connection to the isolation zygote",
+                                duration, outcome);
+            return false;
+        }
+
+        if (timed_out) {
+            record_abnormal_end(test, TestStatus::Timeout,
+                                "Exceeded its " + format_seconds(timeoutSeconds) + " timeout; test process killed",
+                                duration, outcome);
+            return true;
+        }
+        int status = static_cast<int>(header[0]);
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && deserialize_outcome(payload, outcome)) {
+            return true;
+        }
+
+        std::ostringstream message;
+        if (WIFSIGNALED(status)) {
+            message << "Terminated by signal " << WTERMSIG(status) << " (" << strsignal(WTERMSIG(status)) << ")";
+        } else if (WIFEXITED(status)) {
+            message << "Exited with code " << WEXITSTATUS(status) << " before reporting a result";
+        } else {
+            message << "Could not fork a test process";
+        }
+        record_abnormal_end(test, TestStatus::Crashed, message.str(), duration, outcome);
+        return true;
+    }
+
+    void stop() {
+        if (pid_ <= 0) return;
+        ::close(commandFd_);
+        ::close(resultFd_);
+        int status;
+        while (::waitpid(pid_, &status, 0) < 0 && errno == EINTR) {}
+        pid_ = -1;
+    }
+
+private:
+    static std::vector<int>& parent_fds() {
+        static std::vector<int> fds;
+        return fds;
+    }
+
+    static void serve(int commandFd, int resultFd) {
+        uint32_t request;
+        while (read_full(commandFd, &request, sizeof(request))) {
+            int payloadPipe[2];
+            uint32_t header[2] = { 0xffffffffu, 0 };
+            std::string payload;
+
+            pid_t child = ::pipe(payloadPipe) == 0 ? ::fork() : -1;
+            if (child == 0) {
+                ::close(payloadPipe[0]);
+                ::close(commandFd);
+                ::close(resultFd);
+                TestOutcome outcome;
+                run_single_test(registered_tests()[request], outcome);
+                std::cout.flush();
+                std::string bytes = serialize_outcome(outcome);
+                _exit(write_full(payloadPipe[1], bytes.data(), bytes.size()) ? 0 : 1);
+            }
+            uint32_t child_pid = child > 0 ? static_cast<uint32_t>(child) : 0;
+            if (!write_full(resultFd, &child_pid, sizeof(child_pid))) {
+                if (child > 0) ::kill(child, SIGKILL);
+                break;
+            }
+            if (child > 0) {
+                ::close(payloadPipe[1]);
+                payload = read_to_eof(payloadPipe[0]);
+                ::close(payloadPipe[0]);
+                int status = 0;
+                while (::waitpid(child, &status, 0) < 0 && errno == EINTR) {}
+                header[0] = static_cast<uint32_t>(status);
+                header[1] = static_cast<uint32_t>(payload.size());
+            }
+
+            if (!write_full(resultFd, header, sizeof(header)) ||
+                !write_full(resultFd, payload.data(), payload.size())) {
+                break;
+            }
+        }
+        _exit(0);
+    }
+
+    pid_t pid_ = -1;
+    int commandFd_ = -1;
+    int resultFd_ = -1;
+};
+
+#endif // _WIN32
+
+struct RunState {
+    RunOptions options;
+    // One job per run of a test: job i < registered_tests().size() is the first
+    // run of test i, --repeat appends the others
+    std::vector<size_t> jobTest;
+    std::vector<TestOutcome> outcomes;      // By job
+    std::map<std::string, std::string> quarantine;  // Test name -> reason
+#ifndef _WIN32
+    std::vector<IsolationZygote> zygotes;
+    Watchdog watchdog;
+#endif
+};
+
+double timeout_for(const RegisteredTest& test, const RunOptions& options) {
+    return test.timeoutSeconds > 0 ? test.timeoutSeconds : options.timeoutSeconds;
+}
+
+// Runs one test on behalf of a worker; returns false if the worker can no longer run tests
+bool execute_test(size_t worker, size_t job, RunState& state) {
+    const size_t index = state.jobTest[job];
+    const RegisteredTest& test = registered_tests()[index];
+    TestOutcome& outcome = state.outcomes[job];
+    bool healthy = true;
+#ifndef _WIN32
+    const double timeout = timeout_for(test, state.options);
+    const bool watched = state.watchdog.running();
+    if (state.options.isolate) {
+        // Covers the fork and the pipe round trip around the child's own spans
+        test_internal::TraceScope round_trip("isolated run", "isolate");
+        if (watched) state.watchdog.arm(worker, index, 0.0);
+        healthy = state.zygotes[worker].run(index, outcome, timeout, state.watchdog, worker);
+        if (watched) state.watchdog.disarm(worker);
+    } else {
+        if (watched) state.watchdog.arm(worker, index, timeout);
+        run_single_test(test, outcome);
+        if (watched) state.watchdog.disarm(worker);
+    }
+#else
+    run_single_test(test, outcome);
+#endif
+    for (auto& event : outcome.trace) {
+        event.lane = t_trace_lane;
+    }
+    outcome.result.quarantined = state.quarantine.count(test.name) > 0;
+
+    // Repeated tests are reported once, folded, after the run
+    if (state.options.repeat <= 1 || test.benchmark) stream_outcome(test, outcome);
+
+    const std::string& output = outcome.output;
+    if (!output.empty()) {
+        std::lock_guard<std::mutex> lock(g_output_mutex);
+        std::cout << output << std::flush;
+    }
+    return healthy;
+}
+
+void run_worker(size_t self, std::vector<WorkQueue>& queues, RunState& state) {
+    const unsigned previous_lane = t_trace_lane;
+    t_trace_lane = static_cast<unsigned>(self) + 1;
+    uint64_t worker_start = trace_start();
+    size_t job;
+    for (;;) {
+        bool found = queues[self].pop(job);
+        for (size_t k = 1; !found && k < queues.size(); ++k) {
+            found = queues[(self + k) % queues.size()].steal(job);
+        }
+        // Nothing is ever enqueued after start-up, so empty queues mean we are done
+        if (!found || !execute_test(self, job, state)) break;
+    }
+    trace_end("worker", "worker", worker_start);
+    t_trace_lane = previous_lane;
+}
+
+// Below this mean duration timer resolution and cache effects dominate the
+// spread, so --repeat does not call such tests noisy
+const double kNoiseFloorNs = 100e3;
+
+// Folds the runs of a repeated test into the outcome of its first run. The
+// first failing run stands for the test, so its output is the one reported;
+// the pass/fail split and the spread of the durations are added.
+void fold_repeats(const std::vector<size_t>& jobs, std::vector<TestOutcome>& outcomes, double maxCv) {
+    size_t representative = jobs.front();
+    unsigned failures = 0;
+    double total = 0.0;
+    for (size_t job : jobs) {
+        const TestResult& result = outcomes[job].result;
+        if (!result.passed && failures++ == 0) representative = job;
+        total += static_cast<double>(result.duration.count());
+    }
+    const double mean = total / static_cast<double>(jobs.size());
+    double squares = 0.0;
+    for (size_t job : jobs) {
+        double deviation = static_cast<double>(outcomes[job].result.duration.count()) - mean;
+        squares += deviation * deviation;
+    }
+    const double deviation = std::sqrt(squares / static_cast<double>(jobs.size() - 1));
+
+    TestOutcome& folded = outcomes[jobs.front()];
+    if (representative != jobs.front()) {
+        // Every run's spans stay with its own outcome for the timeline
+        std::vector<TraceEvent> spans;
+        spans.swap(folded.trace);
+        folded = outcomes[representative];
+        folded.trace.swap(spans);
+    }
+    TestResult& result = folded.result;
+    result.repeats = static_cast<unsigned>(jobs.size());
+    result.repeatFailures = failures;
+    result.durationCv = mean > 0.0 ? deviation / mean : 0.0;
+    result.flaky = failures > 0 && failures < jobs.size();
+    result.noisy = mean >= kNoiseFloorNs && result.durationCv > maxCv;
+}
+
+// A failure of a test listed in --quarantine is reported but does not count
+bool excused_failure(const TestResult& result) {
+    return result.quarantined && !result.passed;
+}
+
+// Quarantine list: one test name per line, optionally followed by "# reason"
+std::map<std::string, std::string> load_quarantine(const std::string& path) {
+    std::map<std::string, std::string> tests;
+    std::ifstream in(path.c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        std::string name = line.substr(0, hash);
+        name.erase(name.find_last_not_of(" \t\r") + 1);
+        name.erase(0, name.find_first_not_of(" \t"));
+        if (name.empty()) continue;
+        std::string reason = hash == std::string::npos ? std::string() : line.substr(hash + 1);
+        reason.erase(0, reason.find_first_not_of(" \t"));
+        reason.erase(reason.find_last_not_of(" \t\r") + 1);
+        tests[name] = reason;
+    }
+    return tests;
+}
+
+std::string stability_reason(const TestResult& result) {
+    std::ostringstream reason;
+    if (result.flaky) {
+        reason << "flaky: failed " << result.repeatFailures << " of " << result.repeats << " runs";
+    }
+    if (result.noisy) {
+        reason << (result.flaky ? ", " : "") << "noisy: duration CV " << std::fixed << std::setprecision(2)
+               << result.durationCv;
+    }
+    return reason.str();
+}
+
+// Adds the tests this --repeat run flagged and releases listed tests that
+// were stable over every run; tests that did not run keep their entry
+void update_quarantine(const std::string& path, std::map<std::string, std::string>& tests,
+                       const std::vector<TestResult>& results) {
+    size_t added = 0;
+    size_t released = 0;
+    for (const TestResult& result : results) {
+        if (result.repeats <= 1) continue;
+        if (result.flaky || result.noisy) {
+            added += tests.count(result.testName) ? 0 : 1;
+            tests[result.testName] = stability_reason(result);
+        } else if (result.passed && tests.erase(result.testName)) {
+            released++;
+        }
+    }
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp.c_str());
+        if (!out.is_open()) {
+            std::cerr << "Failed to write quarantine file: " << path << std::endl;
+            return;
+        }
+        out << "# Quarantined tests: failures are reported but do not fail the run.\n"
+            << "# Maintained by --repeat; edit freely.\n";
+        for (const auto& entry : tests) {
+            out << entry.first;
+            if (!entry.second.empty()) out << "  # " << entry.second;
+            out << '\n';
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace quarantine file: " << path << std::endl;
+        std::remove(temp.c_str());
+        return;
+    }
+    std::cout << "Quarantine " << path << ": " << added << " added, " << released << " released, "
+              << tests.size() << " listed" << std::endl;
+}
+
+// After --bench-isolate runs: benchmarks measured while other threads
+// competed for the machine are named, since their numbers are mostly noise
+void print_bench_quietness(const std::vector<size_t>& benchmarks, const std::vector<TestOutcome>& outcomes) {
+    std::vector<const TestResult*> busy;
+    size_t recorded = 0;
+    for (size_t index : benchmarks) {
+        const TestResult& result = outcomes[index].result;
+        if (!result.benchEnvironment.recorded) continue;
+        recorded++;
+        if (!result.benchEnvironment.quiet) busy.push_back(&result);
+    }
+    if (recorded == 0) return;
+    std::cout << std::endl << "Benchmark isolation: " << recorded - busy.size() << " of " << recorded
+              << " benchmark" << (recorded > 1 ? "s" : "") << " measured on a quiet machine" << std::endl;
+    for (const TestResult* result : busy) {
+        std::cout << "  [BUSY] " << result->testName << ": " << format_bench_environment(result->benchEnvironment)
+                  << std::endl;
+    }
+    if (!busy.empty()) {
+        std::cout << "  Numbers measured on a busy machine are not comparable with a baseline" << std::endl;
+    }
+}
+
+void print_stability(const std::vector<const TestResult*>& unstable, const RunOptions& options) {
+    std::cout << std::endl << "Stability over " << options.repeat << " runs: ";
+    if (unstable.empty()) {
+        std::cout << "no flaky or noisy tests" << std::endl;
+        return;
+    }
+    std::cout << unstable.size() << " unstable test" << (unstable.size() > 1 ? "s" : "") << std::endl;
+    for (const TestResult* result : unstable) {
+        std::cout << "  [" << (result->flaky ? "FLAKY" : "NOISY") << "] " << result->testName << ": "
+                  << stability_reason(*result) << std::endl;
+    }
+}
+
+} // namespace
+
+// Assertions made outside of a running test (e.g. directly from main) go
+// straight to the global counters
+void record_assertion_pass() {
+    if (t_context) {
+        t_context->passed++;
+    } else {
+        g_tests_passed++;
+    }
+}
+
+void record_assertion_failure(const std::string& where) {
+    if (t_context) {
+        test_internal::AllocationPause pause;
+        t_context->failed++;
+        t_context->failedTests.push_back(*t_context->testName);
+        t_context->log->flush_context();
+    } else {
+        g_tests_failed++;
+        g_failed_tests.push_back(where);
+    }
+}
+
+std::ostream& test_output() {
+    if (t_context) {
+        return t_context->log->stream();
+    }
+    return std::cout;
+}
+
+namespace test_internal {
+
+bool verbose_assertions() {
+    return g_run_options.verbose;
+}
+
+namespace {
+
+// "[PASS] EXPECT_EQ(a, b): detail"; FAIL() and SUCCEED() print just the detail
+void write_assertion_line(std::ostream& out, const char* status, const AssertionSite& site,
+                          const char* detail, size_t detailSize) {
+    out << status;
+    if (site.args) {
+        out << site.macro << '(' << site.args << ')';
+        if (detail) out << ": ";
+    }
+    if (detail) out.write(detail, static_cast<std::streamsize>(detailSize));
+    out << '\n';
+}
+
+} // namespace
+
+void assertion_passed(const AssertionSite& site, const char* detail) {
+    // The literal operand text is enough context for a passing line; the
+    // detail only adds something under --verbose or when there are no operands
+    if (site.args && !verbose_assertions()) detail = nullptr;
+    write_assertion_line(test_output(), "[PASS] ", site, detail, detail ? std::strlen(detail) : 0);
+    record_assertion_pass();
+}
+
+void assertion_passed(const AssertionSite& site, const std::string& detail) {
+    write_assertion_line(test_output(), "[PASS] ", site, detail.data(), detail.size());
+    record_assertion_pass();
+}
+
+AllocationPause::AllocationPause() {
+    t_allocations.paused++;
+}
+
+AllocationPause::~AllocationPause() {
+    t_allocations.paused--;
+}
+
+bool g_trace_enabled = false;
+
+uint64_t trace_clock() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void trace_span(const char* name, const char* category, uint64_t startNs) {
+    if (t_trace_muted) return;
+    uint64_t end = trace_clock();
+    AllocationPause pause;
+    TraceEvent event;
+    event.name = name;
+    event.category = category;
+    event.startNs = startNs;
+    event.durationNs = end > startNs ? end - startNs : 0;
+    event.lane = t_trace_lane;
+    if (t_context && t_context->trace) {
+        t_context->trace->push_back(event);
+    } else {
+        std::lock_guard<std::mutex> lock(g_trace_mutex);
+        g_trace_events.push_back(event);
+    }
+}
+
+AllocationScope::AllocationScope() : start_(t_allocations.allocations) {}
+
+uint64_t AllocationScope::allocations() const {
+    return t_allocations.allocations - start_;
+}
+
+void expect_max_allocs(const AssertionSite& site, uint64_t actual, uint64_t limit) {
+    if (!kAllocationHooks) {
+        assertion_passed(site, "Allocation hooks disabled; not checked");
+        return;
+    }
+    AllocationPause pause;
+    std::ostringstream detail;
+    detail << actual << " allocation" << (actual == 1 ? "" : "s") << ", limit " << limit;
+    if (actual <= limit) {
+        assertion_passed(site, detail.str());
+    } else {
+        assertion_failed(site, detail.str());
+    }
+}
+
+void assertion_failed(const AssertionSite& site, const std::string& detail) {
+    write_assertion_line(test_output(), "[FAIL] ", site, detail.data(), detail.size());
+    record_assertion_failure(site.where);
+}
+
+void expect_condition(const AssertionSite& site, bool value, bool expected) {
+    if (value == expected) {
+        assertion_passed(site, expected ? "Condition true" : "Condition false");
+    } else {
+        assertion_failed(site, expected ? "Condition false" : "Condition should be false");
+    }
+}
+
+void expect_strings(const AssertionSite& site, const StringRef& str1, const StringRef& str2, bool expectEqual) {
+    bool equal = (str1 == str2);
+    if (equal == expectEqual) {
+        assertion_passed(site, expectEqual ? "Strings equal" : "Strings not equal");
+        return;
+    }
+    std::ostringstream detail;
+    if (expectEqual) {
+        detail << "Expected: " << str1 << ", Actual: " << str2;
+    } else {
+        detail << "Strings should not be equal: " << str1;
+    }
+    assertion_failed(site, detail.str());
+}
+
+} // namespace test_internal
+
+void register_test(const std::string& name, TestFunction func, const TestOptions& options, const char* file) {
+    RegisteredTest test;
+    test.name = name;
+    test.func = func;
+    test.timeoutSeconds = options.timeoutSeconds;
+    test.file = file;
+    registered_tests().push_back(test);
+}
+
+void register_benchmark(const std::string& suite, const std::string& name, BenchmarkFunction func,
+                        const char* file) {
+    RegisteredTest test;
+    test.suite = suite;
+    test.name = suite + "." + name;
+    test.benchmark = func;
+    test.file = file;
+    registered_tests().push_back(test);
+}
+
+TestSuiteRegistrar::TestSuiteRegistrar(const char* name, const char* title, const char* reportFile,
+                                       const char* file, const char* note, SuiteEpilogue epilogue) {
+    TestSuite suite;
+    suite.name = name;
+    suite.title = title;
+    suite.reportFile = reportFile;
+    suite.file = file;
+    suite.note = note;
+    suite.epilogue = epilogue;
+    test_suites().push_back(suite);
+}
+
+void BenchmarkState::start_timer() {
+    startTicks_ = g_timer.now();
+}
+
+void BenchmarkState::stop_timer() {
+    if (finished_) return;
+    elapsed_ = g_timer.elapsed(startTicks_, g_timer.now());
+    finished_ = true;
+}
+
+void benchmark_escape(const void* pointer) {
+    g_benchmark_sink = pointer;
+}
+
+void register_test(const std::string& suite, const std::string& name, TestFunction func,
+                   const TestOptions& options, const char* file) {
+    RegisteredTest test;
+    test.suite = suite;
+    test.name = suite + "." + name;
+    test.func = func;
+    test.timeoutSeconds = options.timeoutSeconds;
+    test.file = file;
+    registered_tests().push_back(test);
+}
+
+static std::string shard_report_filename(const std::string& filename);
+
+void run_registered_tests(int argc, char* argv[]) {
+    const std::vector<RegisteredTest>& tests = registered_tests();
+    RunState state;
+    state.options = parse_run_options(argc, argv);
+    g_run_options = state.options;
+    if (state.options.tscTimer && !g_timer.use_tsc()) {
+        std::cout << "No invariant TSC on this machine; timing tests with steady_clock" << std::endl;
+    }
+    if (!state.options.benchBaseline.empty()) {
+        g_benchmark_baseline = load_benchmark_baseline(state.options.benchBaseline);
+    }
+    if (!state.options.profileDir.empty() && !state.options.list) {
+#ifdef TEST_HAVE_PROFILER
+        ::mkdir(state.options.profileDir.c_str(), 0777);
+        g_profiler_running = SamplingProfiler::install(state.options.profileHz);
+        if (!g_profiler_running) {
+            std::cout << "Could not start the SIGPROF timer; profiling disabled" << std::endl;
+        }
+#else
+        std::cout << "Profiling is not supported on this platform; ignoring --profile" << std::endl;
+#endif
+    }
+
+    // An explicit --durations-file also balances shards. The per-binary history
+    // only orders this process's own queues: other runners may not share it.
+    std::string history_file = state.options.durationsFile;
+    if (history_file.empty() && state.options.history && argc > 0) {
+        history_file = std::string(argv[0]) + ".durations";
+    }
+    std::map<std::string, double> durations;
+    if (!history_file.empty()) {
+        durations = load_test_durations(history_file);
+    }
+    std::vector<size_t> candidates = filter_tests(tests, state.options);
+    std::vector<size_t> selected = select_shard(tests, candidates, state.options,
+                                                state.options.durationsFile.empty() ? std::map<std::string, double>()
+                                                                                    : durations);
+    if (state.options.list) {
+        for (size_t index : selected) {
+            std::cout << tests[index].name << std::endl;
+        }
+        std::exit(0);
+    }
+    if (selected.size() != tests.size()) {
+        std::cout << "Running " << selected.size() << " of " << tests.size() << " tests";
+        if (state.options.shardCount > 1) {
+            std::cout << " (shard " << state.options.shardIndex << " of " << state.options.shardCount << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    // Benchmarks run one at a time after the tests so that parallel workers
+    // do not disturb their timings
+    std::vector<size_t> plain;
+    std::vector<size_t> benchmarks;
+    for (size_t index : selected) {
+        (tests[index].benchmark ? benchmarks : plain).push_back(index);
+    }
+
+    if (!state.options.quarantineFile.empty()) {
+        state.quarantine = load_quarantine(state.options.quarantineFile);
+    }
+
+    // Job ids per test: its first run is the test's own index, repeats follow
+    std::vector<std::vector<size_t> > test_jobs(tests.size());
+    state.jobTest.resize(tests.size());
+    for (size_t index = 0; index < tests.size(); ++index) {
+        state.jobTest[index] = index;
+        test_jobs[index].push_back(index);
+    }
+    for (unsigned run = 1; run < state.options.repeat; ++run) {
+        for (size_t index : plain) {
+            test_jobs[index].push_back(state.jobTest.size());
+            state.jobTest.push_back(index);
+        }
+    }
+    const size_t plain_jobs = plain.size() * state.options.repeat;
+
+    unsigned jobs = state.options.jobs;
+    if (jobs > plain_jobs) jobs = plain_jobs == 0 ? 1 : static_cast<unsigned>(plain_jobs);
+    state.outcomes.resize(state.jobTest.size());
+
+    if (!state.options.jsonlReport.empty() &&
+        !g_jsonl_report.open(shard_report_filename(state.options.jsonlReport))) {
+        std::cerr << "Failed to create JSON Lines report: " << state.options.jsonlReport << std::endl;
+    }
+    if (!state.options.junitReport.empty()) {
+        std::string program = argc > 0 ? argv[0] : "tests";
+        size_t slash = program.find_last_of("/\\");
+        if (slash != std::string::npos) program.erase(0, slash + 1);
+        if (!g_junit_report.open(shard_report_filename(state.options.junitReport), program)) {
+            std::cerr << "Failed to create JUnit report: " << state.options.junitReport << std::endl;
+        }
+    }
+
+    // Enabled before the zygotes fork so isolated children record spans too
+    test_internal::g_trace_enabled = !state.options.traceFile.empty();
+    g_trace_origin = trace_start();
+
+#ifdef _WIN32
+    if (state.options.isolate) {
+        std::cout << "Process isolation is not supported on this platform; running in-process" << std::endl;
+        state.options.isolate = false;
+    }
+    if (state.options.timeoutSeconds > 0 || state.options.globalTimeoutSeconds > 0) {
+        std::cout << "Test timeouts are not supported on this platform; ignoring them" << std::endl;
+    }
+#else
+    bool timeouts = state.options.timeoutSeconds > 0 || state.options.globalTimeoutSeconds > 0;
+    for (const RegisteredTest& test : tests) {
+        timeouts = timeouts || test.timeoutSeconds > 0;
+    }
+    if (timeouts) install_backtrace_handler();
+
+    // Zygotes must be forked before any worker thread exists
+    if (state.options.isolate) {
+        std::signal(SIGPIPE, SIG_IGN);
+        state.zygotes.resize(jobs);
+        for (auto& zygote : state.zygotes) {
+            if (!zygote.start()) {
+                std::cerr << "Failed to start isolation zygote: " << std::strerror(errno) << std::endl;
+                std::exit(2);
+            }
+        }
+        std::cout << "Running tests in isolated processes (" << jobs << " zygote" << (jobs > 1 ? "s" : "") << ")" << std::endl;
+    }
+    if (timeouts) state.watchdog.start(jobs, state.options.globalTimeoutSeconds);
+#endif
+
+    std::vector<WorkQueue> queues(jobs);
+    if (jobs > 1 && !durations.empty()) {
+        schedule_longest_first(tests, plain, durations, test_jobs, queues);
+    } else {
+        size_t next = 0;
+        for (unsigned run = 0; run < state.options.repeat; ++run) {
+            for (size_t index : plain) {
+                queues[next++ % jobs].push(test_jobs[index][run]);
+            }
+        }
+    }
+
+    if (state.options.repeat > 1) {
+        std::cout << "Running every test " << state.options.repeat << " times" << std::endl;
+    }
+    if (jobs <= 1) {
+        run_worker(0, queues, state);
+    } else {
+        std::cout << "Running " << plain_jobs << " tests on " << jobs << " worker threads"
+                  << (durations.empty() ? "" : ", longest first") << std::endl;
+        std::vector<std::thread> workers;
+        for (unsigned w = 0; w < jobs; ++w) {
+            workers.push_back(std::thread(run_worker, static_cast<size_t>(w), std::ref(queues), std::ref(state)));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    uint64_t benchmarks_start = benchmarks.empty() ? 0 : trace_start();
+#ifndef TEST_HAVE_BENCH_ISOLATION
+    if (state.options.benchIsolate && !benchmarks.empty()) {
+        std::cout << "Benchmark isolation is not supported on this platform; ignoring --bench-isolate" << std::endl;
+    }
+#endif
+    for (size_t index : benchmarks) {
+        if (!execute_test(0, index, state)) break;
+    }
+    trace_end("benchmarks", "run", benchmarks_start);
+    print_bench_quietness(benchmarks, state.outcomes);
+
+#ifndef _WIN32
+    state.watchdog.stop();
+    for (auto& zygote : state.zygotes) {
+        zygote.stop();
+    }
+#endif
+
+    // Merge in registration order so reports do not depend on scheduling
+    size_t failed_tests = 0;
+    size_t quarantined_failures = 0;
+    std::vector<const TestResult*> unstable;
+    for (size_t index : selected) {
+        TestOutcome& outcome = state.outcomes[index];
+        const bool repeated = test_jobs[index].size() > 1;
+        for (size_t job : test_jobs[index]) {
+            if (state.outcomes[job].ran) continue;
+            record_abnormal_end(tests[index], TestStatus::Crashed, "Not run: every isolation worker was lost",
+                                std::chrono::nanoseconds(0), state.outcomes[job]);
+            state.outcomes[job].result.quarantined = state.quarantine.count(tests[index].name) > 0;
+            if (!repeated) stream_outcome(tests[index], state.outcomes[job]);
+        }
+        if (repeated) {
+            fold_repeats(test_jobs[index], state.outcomes, state.options.maxCv);
+            stream_outcome(tests[index], outcome);
+        }
+        const TestResult& result = outcome.result;
+        g_tests_passed += result.assertionsPassed;
+        if (excused_failure(result)) {
+            quarantined_failures++;
+        } else {
+            g_tests_failed += result.assertionsFailed;
+            g_failed_tests.insert(g_failed_tests.end(), outcome.failedTests.begin(), outcome.failedTests.end());
+            if (!result.passed) failed_tests++;
+        }
+        g_test_results.push_back(result);
+        update_test_duration(durations, result.testName, static_cast<double>(result.duration.count()) / 1e6);
+    }
+    for (const TestResult& result : g_test_results) {
+        if (result.flaky || result.noisy) unstable.push_back(&result);
+    }
+    if (state.options.repeat > 1) {
+        print_stability(unstable, state.options);
+        if (!state.options.quarantineFile.empty()) {
+            update_quarantine(state.options.quarantineFile, state.quarantine, g_test_results);
+        }
+    }
+    if (quarantined_failures > 0) {
+        std::cout << quarantined_failures << " quarantined test" << (quarantined_failures > 1 ? "s" : "")
+                  << " failed; not counted (see " << state.options.quarantineFile << ")" << std::endl;
+    }
+    if (g_jsonl_report.is_open()) {
+        g_jsonl_report.finish(selected.size(), failed_tests, g_tests_passed, g_tests_failed);
+    }
+
+    if (test_internal::g_trace_enabled) {
+        test_internal::g_trace_enabled = false;
+        std::vector<TraceEvent> events;
+        events.swap(g_trace_events);
+        for (const TestOutcome& outcome : state.outcomes) {
+            events.insert(events.end(), outcome.trace.begin(), outcome.trace.end());
+        }
+        // Parents before children when spans start together, for viewers that need it
+        std::stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+            return a.startNs != b.startNs ? a.startNs < b.startNs : a.durationNs > b.durationNs;
+        });
+        write_trace_file(state.options.traceFile, events, jobs);
+    }
+#ifdef TEST_HAVE_PROFILER
+    if (g_profiler_running) {
+        SamplingProfiler::stop_timer();
+        std::cout << "Folded stacks written to " << state.options.profileDir << "/" << std::endl;
+    }
+#endif
+    if (!history_file.empty()) {
+        save_test_durations(history_file, durations);
+    }
+    if (!state.options.historyStore.empty()) {
+        append_performance_history(state.options, g_test_results);
+    }
+    if (!state.options.benchSaveBaseline.empty()) {
+        save_benchmark_baseline(state.options.benchSaveBaseline, g_test_results);
+        std::cout << "Benchmark baseline saved: " << state.options.benchSaveBaseline << std::endl;
+    }
+}
+
+std::string format_duration(std::chrono::nanoseconds duration) {
+    if (duration.count() < 1000) {
+        return std::to_string(duration.count()) + " ns";
+    }
+    return format_nanoseconds(static_cast<double>(duration.count()));
+}
+
+std::string format_perf_counters(const PerfCounters& counters) {
+    std::ostringstream text;
+    const char* separator = "";
+    const struct { const char* label; int64_t value; } fields[] = {
+        { "cycles", counters.cycles },
+        { "instructions", counters.instructions },
+        { "L1D misses", counters.l1dMisses },
+        { "LLC misses", counters.llcMisses },
+        { "branch misses", counters.branchMisses },
+    };
+    for (const auto& field : fields) {
+        if (field.value < 0) continue;
+        text << separator << field.label << " " << field.value;
+        separator = ", ";
+    }
+    if (counters.cycles > 0 && counters.instructions >= 0) {
+        text << " (IPC " << std::fixed << std::setprecision(2)
+             << static_cast<double>(counters.instructions) / static_cast<double>(counters.cycles) << ")";
+    }
+    return text.str();
+}
+
+std::string format_bytes(uint64_t bytes) {
+    if (bytes < 1024) return std::to_string(bytes) + " B";
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    if (bytes < 1024ull * 1024) {
+        text << static_cast<double>(bytes) / 1024.0 << " KiB";
+    } else if (bytes < 1024ull * 1024 * 1024) {
+        text << static_cast<double>(bytes) / (1024.0 * 1024.0) << " MiB";
+    } else {
+        text << static_cast<double>(bytes) / (1024.0 * 1024.0 * 1024.0) << " GiB";
+    }
+    return text.str();
+}
+
+std::string format_signed_bytes(int64_t bytes) {
+    if (bytes < 0) return "-" + format_bytes(static_cast<uint64_t>(-bytes));
+    return "+" + format_bytes(static_cast<uint64_t>(bytes));
+}
+
+const char* test_status_name(TestStatus status) {
+    switch (status) {
+    case TestStatus::Passed:  return "PASSED";
+    case TestStatus::Failed:  return "FAILED";
+    case TestStatus::Crashed: return "CRASHED";
+    case TestStatus::Timeout: return "TIMEOUT";
+    }
+    return "UNKNOWN";
+}
+
+// Sharded runs get their own report file so shards sharing a directory do not
+// overwrite each other, e.g. basic_functionality_shard1of4_report.txt
+static std::string shard_report_filename(const std::string& filename) {
+    if (g_run_options.shardCount <= 1) return filename;
+    std::ostringstream tag;
+    tag << "_shard" << g_run_options.shardIndex << "of" << g_run_options.shardCount;
+
+    const std::string suffix = "_report.txt";
+    size_t insert_at;
+    if (filename.size() >= suffix.size() &&
+        filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        insert_at = filename.size() - suffix.size();
+    } else {
+        size_t dot = filename.rfind('.');
+        size_t slash = filename.find_last_of("/\\");
+        insert_at = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? filename.size() : dot;
+    }
+    return filename.substr(0, insert_at) + tag.str() + filename.substr(insert_at);
+}
+
+void generate_test_report(const std::string& requested_filename) {
+    std::string filename = shard_report_filename(requested_filename);
     std::ofstream report(filename);
     if (!report.is_open()) {
         std::cerr << "Failed to create test report file: " << filename << std::endl;
@@ -38,6 +3424,9 @@ void generate_test_report(const std::string& filename) {
     report << "BOOTGEN UNIT TEST REPORT" << std::endl;
     report << "======================================" << std::endl;
     report << "Generated: " << std::ctime(&time);
+    if (g_run_options.shardCount > 1) {
+        report << "Shard: " << g_run_options.shardIndex << " of " << g_run_options.shardCount << std::endl;
+    }
     report << "Total Tests: " << (g_tests_passed + g_tests_failed) << std::endl;
     report << "Passed: " << g_tests_passed << std::endl;
     report << "Failed: " << g_tests_failed << std::endl;
@@ -55,8 +3444,30 @@ void generate_test_report(const std::string& filename) {
     
     for (const auto& result : g_test_results) {
         report << "Test: " << result.testName << std::endl;
-        report << "  Status: " << (result.passed ? "PASSED" : "FAILED") << std::endl;
-        report << "  Duration: " << result.duration.count() << "ms" << std::endl;
+        report << "  Status: " << test_status_name(result.status) << (result.quarantined ? " (quarantined)" : "")
+               << std::endl;
+        if (result.repeats > 1) {
+            report << "  Runs: " << result.repeats << ", failed " << result.repeatFailures << ", duration CV "
+                   << std::fixed << std::setprecision(2) << result.durationCv << std::endl;
+        }
+        report << "  Duration: " << format_duration(result.duration) << std::endl;
+        if (result.counters.available()) {
+            report << "  Counters: " << format_perf_counters(result.counters) << std::endl;
+        }
+        if (result.resources.available) {
+            const ResourceUsage& usage = result.resources;
+            report << "  Memory: RSS " << format_signed_bytes(usage.rssDeltaBytes);
+            if (usage.peakRssDeltaBytes >= 0) {
+                report << ", peak RSS +" << format_bytes(static_cast<uint64_t>(usage.peakRssDeltaBytes));
+            }
+            report << ", page faults " << usage.minorFaults << " minor / " << usage.majorFaults << " major"
+                   << ", context switches " << usage.voluntarySwitches << " voluntary / "
+                   << usage.involuntarySwitches << " involuntary" << std::endl;
+        }
+        if (kAllocationHooks) {
+            report << "  Allocations: " << result.allocations << " (" << format_bytes(result.allocatedBytes)
+                   << "), frees: " << result.deallocations << ", peak live: " << format_bytes(result.peakLiveBytes) << std::endl;
+        }
         if (!result.passed && !result.errorMessage.empty()) {
             report << "  Error: " << result.errorMessage << std::endl;
         }
@@ -73,27 +3484,125 @@ void generate_test_report(const std::string& filename) {
         report << std::endl;
     }
 
+    // --repeat findings
+    bool have_unstable = false;
+    for (const auto& result : g_test_results) {
+        if (!result.flaky && !result.noisy) continue;
+        if (!have_unstable) {
+            report << "FLAKY AND NOISY TESTS (" << result.repeats << " runs each):" << std::endl;
+            report << "======================================" << std::endl;
+            have_unstable = true;
+        }
+        report << "- " << result.testName << ": " << stability_reason(result) << std::endl;
+    }
+    if (have_unstable) report << std::endl;
+
+    // Benchmark results
+    bool have_benchmarks = false;
+    for (const auto& result : g_test_results) {
+        if (result.benchmarkSamples.empty()) continue;
+        if (!have_benchmarks) {
+            report << "BENCHMARK RESULTS (time per iteration):" << std::endl;
+            report << "======================================" << std::endl;
+            have_benchmarks = true;
+        }
+        SampleSummary summary = summarize_samples(result.benchmarkSamples);
+        report << "Benchmark: " << result.testName << std::endl;
+        report << "  Samples: " << summary.count << " x " << result.benchmarkIterations << " iterations" << std::endl;
+        report << "  Median: " << format_nanoseconds(summary.median) << std::endl;
+        report << "  p90: " << format_nanoseconds(summary.p90) << std::endl;
+        report << "  p99: " << format_nanoseconds(summary.p99) << std::endl;
+        report << "  MAD: " << format_nanoseconds(summary.mad) << std::endl;
+        report << "  Min/Max: " << format_nanoseconds(summary.min) << " / " << format_nanoseconds(summary.max) << std::endl;
+        if (result.benchEnvironment.recorded) {
+            report << "  Environment: " << format_bench_environment(result.benchEnvironment) << std::endl;
+        }
+        report << std::endl;
+    }
+
     // Performance summary
     if (!g_test_results.empty()) {
         report << "PERFORMANCE SUMMARY:" << std::endl;
         report << "======================================" << std::endl;
         
-        auto total_duration = std::chrono::milliseconds(0);
-        auto min_duration = g_test_results[0].duration;
-        auto max_duration = g_test_results[0].duration;
+        auto total_duration = std::chrono::nanoseconds(0);
+        const TestResult* fastest = &g_test_results[0];
+        const TestResult* slowest = &g_test_results[0];
         
         for (const auto& result : g_test_results) {
             total_duration += result.duration;
-            if (result.duration < min_duration) min_duration = result.duration;
-            if (result.duration > max_duration) max_duration = result.duration;
+            if (result.duration < fastest->duration) fastest = &result;
+            if (result.duration > slowest->duration) slowest = &result;
         }
         
-        auto avg_duration = total_duration / g_test_results.size();
+        auto avg_duration = total_duration / static_cast<int64_t>(g_test_results.size());
         
-        report << "Total Execution Time: " << total_duration.count() << "ms" << std::endl;
-        report << "Average Test Time: " << avg_duration.count() << "ms" << std::endl;
-        report << "Fastest Test: " << min_duration.count() << "ms" << std::endl;
-        report << "Slowest Test: " << max_duration.count() << "ms" << std::endl;
+        report << "Timer: " << g_timer.describe() << std::endl;
+        report << "Total Execution Time: " << format_duration(total_duration) << std::endl;
+        report << "Average Test Time: " << format_duration(avg_duration) << std::endl;
+        report << "Fastest Test: " << format_duration(fastest->duration) << " (" << fastest->testName << ")" << std::endl;
+        report << "Slowest Test: " << format_duration(slowest->duration) << " (" << slowest->testName << ")" << std::endl;
+        PerfCounters total_counters;
+        bool have_counters = false;
+        for (const auto& result : g_test_results) {
+            if (!result.counters.available()) continue;
+            int64_t* totals[] = { &total_counters.cycles, &total_counters.instructions, &total_counters.l1dMisses,
+                                  &total_counters.llcMisses, &total_counters.branchMisses };
+            const int64_t values[] = { result.counters.cycles, result.counters.instructions, result.counters.l1dMisses,
+                                       result.counters.llcMisses, result.counters.branchMisses };
+            for (size_t k = 0; k < 5; ++k) {
+                if (values[k] < 0) continue;
+                *totals[k] = (*totals[k] < 0 ? 0 : *totals[k]) + values[k];
+            }
+            have_counters = true;
+        }
+        if (have_counters) {
+            report << "Total Counters: " << format_perf_counters(total_counters) << std::endl;
+        }
+
+        ResourceUsage total_usage;
+        const TestResult* most_rss = nullptr;
+        const TestResult* highest_peak = nullptr;
+        for (const auto& result : g_test_results) {
+            const ResourceUsage& usage = result.resources;
+            if (!usage.available) continue;
+            total_usage.available = true;
+            total_usage.minorFaults += usage.minorFaults;
+            total_usage.majorFaults += usage.majorFaults;
+            total_usage.voluntarySwitches += usage.voluntarySwitches;
+            total_usage.involuntarySwitches += usage.involuntarySwitches;
+            if (!most_rss || usage.rssDeltaBytes > most_rss->resources.rssDeltaBytes) most_rss = &result;
+            if (usage.peakRssDeltaBytes >= 0 &&
+                (!highest_peak || usage.peakRssDeltaBytes > highest_peak->resources.peakRssDeltaBytes)) {
+                highest_peak = &result;
+            }
+        }
+        if (total_usage.available) {
+            report << "Total Page Faults: " << total_usage.minorFaults << " minor / " << total_usage.majorFaults << " major" << std::endl;
+            report << "Total Context Switches: " << total_usage.voluntarySwitches << " voluntary / "
+                   << total_usage.involuntarySwitches << " involuntary" << std::endl;
+            report << "Largest RSS Growth: " << format_signed_bytes(most_rss->resources.rssDeltaBytes)
+                   << " (" << most_rss->testName << ")" << std::endl;
+            if (highest_peak) {
+                report << "Highest Peak RSS Growth: +" << format_bytes(static_cast<uint64_t>(highest_peak->resources.peakRssDeltaBytes))
+                       << " (" << highest_peak->testName << ")" << std::endl;
+            }
+        }
+        if (kAllocationHooks) {
+            uint64_t total_allocations = 0;
+            uint64_t total_bytes = 0;
+            const TestResult* most_allocating = &g_test_results[0];
+            const TestResult* peak_memory = &g_test_results[0];
+            for (const auto& result : g_test_results) {
+                total_allocations += result.allocations;
+                total_bytes += result.allocatedBytes;
+                if (result.allocations > most_allocating->allocations) most_allocating = &result;
+                if (result.peakLiveBytes > peak_memory->peakLiveBytes) peak_memory = &result;
+            }
+            report << "Total Allocations: " << total_allocations << " (" << format_bytes(total_bytes) << ")" << std::endl;
+            report << "Most Allocations: " << most_allocating->allocations << " (" << most_allocating->testName << ")" << std::endl;
+            report << "Highest Peak Heap: " << format_bytes(peak_memory->peakLiveBytes) << " (" << peak_memory->testName << ")" << std::endl;
+        }
     }
 
     report.close();
@@ -133,3 +3642,119 @@ void print_test_summary() {
 int get_exit_code() {
     return (g_tests_failed == 0) ? 0 : 1;
 }
+
+// Writes the report of one suite of a multi-suite run by narrowing the global
+// results to that suite's tests for the duration of generate_test_report()
+static int generate_suite_report(const TestSuite& suite, const std::set<std::string>& names) {
+    std::vector<TestResult> all_results;
+    std::vector<std::string> all_failed;
+    all_results.swap(g_test_results);
+    all_failed.swap(g_failed_tests);
+    const int all_passed = g_tests_passed;
+    const int all_failures = g_tests_failed;
+
+    g_tests_passed = 0;
+    g_tests_failed = 0;
+    for (const TestResult& result : all_results) {
+        if (!names.count(result.testName)) continue;
+        g_test_results.push_back(result);
+        g_tests_passed += result.assertionsPassed;
+        if (excused_failure(result)) continue;     // Not counted in the run's totals either
+        g_tests_failed += result.assertionsFailed;
+        g_failed_tests.insert(g_failed_tests.end(), static_cast<size_t>(result.assertionsFailed), result.testName);
+    }
+    generate_test_report(suite.reportFile);
+    const int failures = g_tests_failed;
+
+    g_test_results.swap(all_results);
+    g_failed_tests.swap(all_failed);
+    g_tests_passed = all_passed;
+    g_tests_failed = all_failures;
+    return failures;
+}
+
+int run_test_suites(int argc, char* argv[]) {
+    // --suite and --list-suites are consumed here; the rest go to run_registered_tests
+    std::vector<char*> args;
+    std::set<std::string> wanted;
+    bool list_suites = false;
+    if (argc > 0) args.push_back(argv[0]);
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = nullptr;
+        if (match_option(arg, "--suite", i, argc, argv, value)) {
+            std::stringstream names(value);
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!name.empty()) wanted.insert(name);
+            }
+        } else if (arg == "--list-suites") {
+            list_suites = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    std::vector<TestSuite>& suites = test_suites();
+    std::vector<const TestSuite*> selected;
+    std::set<std::string> unknown(wanted);
+    for (const TestSuite& suite : suites) {
+        if (list_suites) {
+            std::cout << suite.name << " - " << suite.title << std::endl;
+        } else if (wanted.empty() || wanted.count(suite.name)) {
+            selected.push_back(&suite);
+            unknown.erase(suite.name);
+        }
+    }
+    if (list_suites) return 0;
+    if (!unknown.empty()) {
+        std::cerr << "Unknown suite: " << *unknown.begin() << " (see --list-suites)" << std::endl;
+        return 2;
+    }
+
+    // Keep the selected suites' tests; tests outside any suite only run when every suite does
+    std::vector<std::set<std::string> > suite_tests(selected.size());
+    std::vector<RegisteredTest>& tests = registered_tests();
+    std::vector<RegisteredTest> kept;
+    for (const RegisteredTest& test : tests) {
+        bool keep = selected.size() == suites.size();
+        for (size_t k = 0; k < selected.size(); ++k) {
+            if (test.file && std::strcmp(test.file, selected[k]->file) == 0) {
+                suite_tests[k].insert(test.name);
+                keep = true;
+            }
+        }
+        if (keep) kept.push_back(test);
+    }
+    tests.swap(kept);
+
+    std::string banner;
+    if (selected.size() == 1) {
+        banner = "Running " + selected[0]->title + "...";
+    } else {
+        std::ostringstream text;
+        text << "Running " << selected.size() << " Test Suites...";
+        banner = text.str();
+    }
+    std::cout << banner << std::endl;
+    std::cout << std::string(banner.size(), '=') << std::endl;
+    for (const TestSuite* suite : selected) {
+        if (selected.size() > 1) std::cout << "  " << suite->name << " - " << suite->title << std::endl;
+        if (suite->note) std::cout << suite->note << std::endl;
+    }
+
+    args.push_back(nullptr);
+    run_registered_tests(static_cast<int>(args.size() - 1), args.data());
+
+    print_test_summary();
+    if (selected.size() == 1) {
+        generate_test_report(selected[0]->reportFile);
+        if (selected[0]->epilogue) selected[0]->epilogue(g_tests_failed);
+    } else {
+        for (size_t k = 0; k < selected.size(); ++k) {
+            int failures = generate_suite_report(*selected[k], suite_tests[k]);
+            if (selected[k]->epilogue) selected[k]->epilogue(failures);
+        }
+    }
+    return get_exit_code();
+}
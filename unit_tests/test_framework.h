@@ -27,37 +27,249 @@
 #include <cassert>
 #include <chrono>
 #include <fstream>
+#include <cstring>
+#include <cstdint>
 
-// Global test counters
+// Global test counters (merged from the per-thread counters once a run completes)
 extern int g_tests_passed;
 extern int g_tests_failed;
 extern std::vector<std::string> g_failed_tests;
 
 // Test result tracking
+enum class TestStatus {
+    Passed,
+    Failed,
+    Crashed,    // The isolated child process died before reporting a result
+    Timeout     // Exceeded its --timeout / TestOptions::Timeout or the --global-timeout
+};
+
+const char* test_status_name(TestStatus status);
+
+// Hardware event counts (perf_event_open, user space only); -1 where a
+// counter could not be opened on this machine
+struct PerfCounters {
+    int64_t cycles = -1;
+    int64_t instructions = -1;
+    int64_t l1dMisses = -1;
+    int64_t llcMisses = -1;
+    int64_t branchMisses = -1;
+
+    bool available() const {
+        return cycles >= 0 || instructions >= 0 || l1dMisses >= 0 || llcMisses >= 0 || branchMisses >= 0;
+    }
+};
+
+// Memory and scheduler activity around a test (Linux). Faults and context
+// switches are the test thread's own; RSS is process-wide, so RSS numbers are
+// only attributable to one test in serial or --isolate runs.
+struct ResourceUsage {
+    bool available = false;
+    int64_t rssDeltaBytes = 0;          // Resident set size after minus before
+    int64_t peakRssDeltaBytes = -1;     // Peak RSS above the starting RSS; -1 if it could not be reset
+    int64_t minorFaults = 0;
+    int64_t majorFaults = 0;
+    int64_t voluntarySwitches = 0;
+    int64_t involuntarySwitches = 0;
+};
+
+// How a benchmark was measured under --bench-isolate (Linux), and whether the
+// machine was quiet enough while it ran for the numbers to be trusted
+struct BenchEnvironment {
+    bool recorded = false;
+    int cpu = -1;                       // Core the thread was pinned to; -1 if pinning failed
+    int niceness = 0;                   // Nice value it ran at
+    double spinUpMs = 0.0;              // Busy loop before calibration
+    bool spinUpSteady = false;          // The loop's speed settled before the cap
+    double loadAverage = 0.0;           // One-minute load average after measuring
+    double otherRunnable = 0.0;         // Mean runnable threads besides the benchmark's
+    double runQueueWait = 0.0;          // Fraction of the measurement spent waiting for the core
+    unsigned cpus = 0;                  // Online cores
+    bool quiet = false;
+};
+
 struct TestResult {
     std::string testName;
-    bool passed;
+    bool passed = false;
+    TestStatus status = TestStatus::Failed;
     std::string errorMessage;
-    std::chrono::milliseconds duration;
+    std::chrono::nanoseconds duration{0};
+    int assertionsPassed = 0;
+    int assertionsFailed = 0;
+    // Heap activity of the test's thread while it ran (global operator new/delete)
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t peakLiveBytes = 0;         // Peak of bytes allocated and not yet freed
+    PerfCounters counters;              // Hardware counters of the test's thread
+    ResourceUsage resources;
+    // Benchmarks only: nanoseconds per iteration of each measured batch
+    std::vector<double> benchmarkSamples;
+    uint64_t benchmarkIterations = 0;   // Iterations per measured batch
+    uint64_t benchmarkAllocations = 0;  // Allocations over all measured batches
+    BenchEnvironment benchEnvironment;
+    // --repeat runs only: the result above is the first failing run, else the first run
+    unsigned repeats = 0;
+    unsigned repeatFailures = 0;
+    double durationCv = 0.0;            // Coefficient of variation of the run durations
+    bool flaky = false;                 // Both passed and failed
+    bool noisy = false;                 // durationCv above --max-cv
+    bool quarantined = false;           // Listed in --quarantine: a failure does not fail the run
 };
 
 extern std::vector<TestResult> g_test_results;
 
+// Human-readable duration with a unit picked to fit, e.g. "845 ns", "12.408 ms"
+std::string format_duration(std::chrono::nanoseconds duration);
+
+// Human-readable byte count, e.g. "512 B", "12.3 KiB"
+std::string format_bytes(uint64_t bytes);
+std::string format_signed_bytes(int64_t bytes);     // "+12.0 KiB", "-4.0 KiB"
+
+// "cycles 1200, instructions 2400, ... (IPC 2.00)", listing available counters only
+std::string format_perf_counters(const PerfCounters& counters);
+
+// Assertion bookkeeping for the test running on the calling thread
+void record_assertion_pass();
+void record_assertion_failure(const std::string& where);
+
+// Stream that assertion output goes to. Inside a test it is an in-memory log
+// that is printed once the test finishes: in full with --verbose, otherwise
+// only the lines leading up to each failure. Outside a test it is std::cout.
+std::ostream& test_output();
+
+// Assertion core behind the EXPECT_* macros. Every operand is evaluated once,
+// the operand text is captured as a string literal at compile time, and
+// values are only formatted when an assertion fails or --verbose asks for
+// passing lines. A passing assertion in a normal run logs just its literal
+// text and does not allocate.
+namespace test_internal {
+
+struct AssertionSite {
+    const char* macro;      // e.g. "EXPECT_EQ"
+    const char* args;       // Operand text as written; nullptr for SUCCEED()/FAIL()
+    const char* where;      // Enclosing function, for failures outside a test
+};
+
+// Lengths are measured once; a null C string stays distinguishable from ""
+class StringRef {
+public:
+    StringRef(const char* text) : data_(text), size_(text ? std::strlen(text) : 0) {}
+    StringRef(const std::string& text) : data_(text.data()), size_(text.size()) {}
+
+    bool operator==(const StringRef& other) const {
+        if (!data_ || !other.data_) return data_ == other.data_;
+        return size_ == other.size_ && std::memcmp(data_, other.data_, size_) == 0;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const StringRef& text) {
+        if (!text.data_) return out << "(null)";
+        out << '\'';
+        out.write(text.data_, static_cast<std::streamsize>(text.size_));
+        return out << '\'';
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+bool verbose_assertions();
+void assertion_passed(const AssertionSite& site, const char* detail = nullptr);
+void assertion_passed(const AssertionSite& site, const std::string& detail);
+void assertion_failed(const AssertionSite& site, const std::string& detail);
+void expect_condition(const AssertionSite& site, bool value, bool expected);
+void expect_max_allocs(const AssertionSite& site, uint64_t actual, uint64_t limit);
+
+// While alive, allocations made by this thread are not charged to the running
+// test; used around the framework's own bookkeeping and formatting
+class AllocationPause {
+public:
+    AllocationPause();
+    ~AllocationPause();
+    AllocationPause(const AllocationPause&) = delete;
+    AllocationPause& operator=(const AllocationPause&) = delete;
+};
+
+// Counts the allocations made by this thread since construction
+class AllocationScope {
+public:
+    AllocationScope();
+    uint64_t allocations() const;
+
+private:
+    uint64_t start_;
+};
+void expect_strings(const AssertionSite& site, const StringRef& str1, const StringRef& str2, bool expectEqual);
+
+template <typename T>
+std::string format_detail(const T& value) {
+    std::ostringstream detail;
+    detail << value;
+    return detail.str();
+}
+
+struct CheckEq {
+    template <typename A, typename B> static bool holds(const A& a, const B& b) { return a == b; }
+    template <typename A, typename B> static void pass(std::ostream& out, const A& a, const B&) { out << "Values equal: " << a; }
+    template <typename A, typename B> static void fail(std::ostream& out, const A& a, const B& b) { out << "Expected: " << a << ", Actual: " << b; }
+};
+
+struct CheckNe {
+    template <typename A, typename B> static bool holds(const A& a, const B& b) { return a != b; }
+    template <typename A, typename B> static void pass(std::ostream& out, const A& a, const B& b) { out << "Values not equal: " << a << " != " << b; }
+    template <typename A, typename B> static void fail(std::ostream& out, const A& a, const B&) { out << "Values should not be equal: " << a; }
+};
+
+#define TEST_RELATIONAL_CHECK(check, op) \
+    struct check { \
+        template <typename A, typename B> static bool holds(const A& a, const B& b) { return a op b; } \
+        template <typename A, typename B> static void pass(std::ostream& out, const A& a, const B& b) { out << a << " " #op " " << b; } \
+        template <typename A, typename B> static void fail(std::ostream& out, const A& a, const B& b) { out << a << " not " #op " " << b; } \
+    }
+
+TEST_RELATIONAL_CHECK(CheckLt, <);
+TEST_RELATIONAL_CHECK(CheckGt, >);
+TEST_RELATIONAL_CHECK(CheckLe, <=);
+TEST_RELATIONAL_CHECK(CheckGe, >=);
+
+#undef TEST_RELATIONAL_CHECK
+
+template <typename Check, typename A, typename B>
+void expect_binary(const AssertionSite& site, const A& a, const B& b) {
+    if (Check::holds(a, b)) {
+        if (!verbose_assertions()) {
+            assertion_passed(site);
+            return;
+        }
+        AllocationPause pause;
+        std::ostringstream detail;
+        Check::pass(detail, a, b);
+        assertion_passed(site, detail.str());
+    } else {
+        AllocationPause pause;
+        std::ostringstream detail;
+        Check::fail(detail, a, b);
+        assertion_failed(site, detail.str());
+    }
+}
+
+} // namespace test_internal
+
+#define TEST_ASSERTION_SITE(macro, args) \
+    test_internal::AssertionSite{ macro, args, __func__ }
+
 // Simple test framework macros
 #define EXPECT_NO_THROW(statement) \
     do { \
         try { \
             statement; \
-            std::cout << "[PASS] No exception thrown" << std::endl; \
-            g_tests_passed++; \
+            test_internal::assertion_passed(TEST_ASSERTION_SITE("EXPECT_NO_THROW", #statement), "No exception thrown"); \
         } catch (const std::exception& e) { \
-            std::cout << "[FAIL] Unexpected exception thrown: " << e.what() << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
+            test_internal::assertion_failed(TEST_ASSERTION_SITE("EXPECT_NO_THROW", #statement), \
+                std::string("Unexpected exception thrown: ") + e.what()); \
         } catch (...) { \
-            std::cout << "[FAIL] Unexpected unknown exception thrown" << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
+            test_internal::assertion_failed(TEST_ASSERTION_SITE("EXPECT_NO_THROW", #statement), \
+                "Unexpected unknown exception thrown"); \
         } \
     } while(0)
 
@@ -65,185 +277,271 @@ extern std::vector<TestResult> g_test_results;
     do { \
         try { \
             statement; \
-            std::cout << "[FAIL] Expected exception not thrown" << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
+            test_internal::assertion_failed(TEST_ASSERTION_SITE("EXPECT_THROW", #statement ", " #exception_type), \
+                "Expected exception not thrown"); \
         } catch (const exception_type&) { \
-            std::cout << "[PASS] Expected exception caught" << std::endl; \
-            g_tests_passed++; \
+            test_internal::assertion_passed(TEST_ASSERTION_SITE("EXPECT_THROW", #statement ", " #exception_type), \
+                "Expected exception caught"); \
         } catch (const std::exception& e) { \
-            std::cout << "[FAIL] Wrong exception type thrown: " << e.what() << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
+            test_internal::assertion_failed(TEST_ASSERTION_SITE("EXPECT_THROW", #statement ", " #exception_type), \
+                std::string("Wrong exception type thrown: ") + e.what()); \
         } catch (...) { \
-            std::cout << "[FAIL] Wrong exception type thrown (unknown)" << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
+            test_internal::assertion_failed(TEST_ASSERTION_SITE("EXPECT_THROW", #statement ", " #exception_type), \
+                "Wrong exception type thrown (unknown)"); \
         } \
     } while(0)
 
 #define EXPECT_EQ(expected, actual) \
-    do { \
-        if ((expected) == (actual)) { \
-            std::cout << "[PASS] Values equal: " << (expected) << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] Expected: " << (expected) << ", Actual: " << (actual) << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_binary<test_internal::CheckEq>( \
+        TEST_ASSERTION_SITE("EXPECT_EQ", #expected ", " #actual), (expected), (actual))
 
 #define EXPECT_NE(val1, val2) \
-    do { \
-        if ((val1) != (val2)) { \
-            std::cout << "[PASS] Values not equal: " << (val1) << " != " << (val2) << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] Values should not be equal: " << (val1) << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_binary<test_internal::CheckNe>( \
+        TEST_ASSERTION_SITE("EXPECT_NE", #val1 ", " #val2), (val1), (val2))
 
 #define EXPECT_TRUE(condition) \
-    do { \
-        if (condition) { \
-            std::cout << "[PASS] Condition true" << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] Condition false" << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_condition(TEST_ASSERTION_SITE("EXPECT_TRUE", #condition), \
+        static_cast<bool>(condition), true)
 
 #define EXPECT_FALSE(condition) \
-    do { \
-        if (!(condition)) { \
-            std::cout << "[PASS] Condition false" << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] Condition should be false" << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_condition(TEST_ASSERTION_SITE("EXPECT_FALSE", #condition), \
+        static_cast<bool>(condition), false)
 
 #define EXPECT_LT(val1, val2) \
-    do { \
-        if ((val1) < (val2)) { \
-            std::cout << "[PASS] " << (val1) << " < " << (val2) << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] " << (val1) << " not < " << (val2) << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_binary<test_internal::CheckLt>( \
+        TEST_ASSERTION_SITE("EXPECT_LT", #val1 ", " #val2), (val1), (val2))
 
 #define EXPECT_GT(val1, val2) \
-    do { \
-        if ((val1) > (val2)) { \
-            std::cout << "[PASS] " << (val1) << " > " << (val2) << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] " << (val1) << " not > " << (val2) << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_binary<test_internal::CheckGt>( \
+        TEST_ASSERTION_SITE("EXPECT_GT", #val1 ", " #val2), (val1), (val2))
 
 #define EXPECT_LE(val1, val2) \
-    do { \
-        if ((val1) <= (val2)) { \
-            std::cout << "[PASS] " << (val1) << " <= " << (val2) << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] " << (val1) << " not <= " << (val2) << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_binary<test_internal::CheckLe>( \
+        TEST_ASSERTION_SITE("EXPECT_LE", #val1 ", " #val2), (val1), (val2))
 
 #define EXPECT_GE(val1, val2) \
-    do { \
-        if ((val1) >= (val2)) { \
-            std::cout << "[PASS] " << (val1) << " >= " << (val2) << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] " << (val1) << " not >= " << (val2) << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_binary<test_internal::CheckGe>( \
+        TEST_ASSERTION_SITE("EXPECT_GE", #val1 ", " #val2), (val1), (val2))
 
 #define EXPECT_STREQ(str1, str2) \
-    do { \
-        if (std::string(str1) == std::string(str2)) { \
-            std::cout << "[PASS] Strings equal" << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] Expected: '" << (str1) << "', Actual: '" << (str2) << "'" << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
-    } while(0)
+    test_internal::expect_strings(TEST_ASSERTION_SITE("EXPECT_STREQ", #str1 ", " #str2), (str1), (str2), true)
 
 #define EXPECT_STRNE(str1, str2) \
+    test_internal::expect_strings(TEST_ASSERTION_SITE("EXPECT_STRNE", #str1 ", " #str2), (str1), (str2), false)
+
+// Fails unless 'statement' makes at most max_allocs heap allocations on this thread
+#define EXPECT_MAX_ALLOCS(max_allocs, statement) \
     do { \
-        if (std::string(str1) != std::string(str2)) { \
-            std::cout << "[PASS] Strings not equal" << std::endl; \
-            g_tests_passed++; \
-        } else { \
-            std::cout << "[FAIL] Strings should not be equal: '" << (str1) << "'" << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(__func__); \
-        } \
+        test_internal::AllocationScope alloc_scope_; \
+        statement; \
+        test_internal::expect_max_allocs(TEST_ASSERTION_SITE("EXPECT_MAX_ALLOCS", #max_allocs ", " #statement), \
+            alloc_scope_.allocations(), (max_allocs)); \
     } while(0)
 
 #define SUCCEED() \
-    do { \
-        std::cout << "[PASS] Test succeeded" << std::endl; \
-        g_tests_passed++; \
-    } while(0)
+    test_internal::assertion_passed(TEST_ASSERTION_SITE("SUCCEED", nullptr), "Test succeeded")
 
 #define FAIL(message) \
-    do { \
-        std::cout << "[FAIL] " << (message) << std::endl; \
-        g_tests_failed++; \
-        g_failed_tests.push_back(__func__); \
-    } while(0)
+    test_internal::assertion_failed(TEST_ASSERTION_SITE("FAIL", nullptr), test_internal::format_detail(message))
 
-// Test registration macros
-#define RUN_TEST(test_func) \
-    do { \
-        std::cout << "\n=== Running: " << #test_func << " ===" << std::endl; \
-        auto start_time = std::chrono::high_resolution_clock::now(); \
-        int initial_failed = g_tests_failed; \
-        try { \
-            test_func(); \
-        } catch (const std::exception& e) { \
-            std::cout << "[EXCEPTION] " << e.what() << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(#test_func); \
-        } catch (...) { \
-            std::cout << "[UNKNOWN EXCEPTION]" << std::endl; \
-            g_tests_failed++; \
-            g_failed_tests.push_back(#test_func); \
-        } \
-        auto end_time = std::chrono::high_resolution_clock::now(); \
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time); \
-        TestResult result; \
-        result.testName = #test_func; \
-        result.passed = (g_tests_failed == initial_failed); \
-        result.duration = duration; \
-        if (!result.passed && g_tests_failed > initial_failed) { \
-            result.errorMessage = "Test failed with assertions"; \
-        } \
-        g_test_results.push_back(result); \
-        std::cout << "Test completed in " << duration.count() << "ms" << std::endl; \
-    } while(0)
+// Test registration. TEST(Suite, Name) { ... } defines a test that registers
+// itself as "Suite.Name" before main() runs, so the runner can list, filter
+// and reorder tests without a hand-written list. RUN_TEST(func) queues an
+// existing function under its own name.
+// RUN_TEST(func, options) and TEST_WITH_OPTIONS(Suite, Name, options) attach
+// per-test settings, e.g. TestOptions().Timeout(30) for a test that may block.
+typedef void (*TestFunction)();
+
+struct TestOptions {
+    double timeoutSeconds = 0.0;    // 0: the --timeout default applies
+
+    TestOptions& Timeout(double seconds) {
+        timeoutSeconds = seconds;
+        return *this;
+    }
+};
+
+// 'file' is the registering source file (__FILE__); it ties the test to the
+// TEST_SUITE declared in the same file
+void register_test(const std::string& name, TestFunction func, const TestOptions& options = TestOptions(),
+                   const char* file = nullptr);
+void register_test(const std::string& suite, const std::string& name, TestFunction func,
+                   const TestOptions& options = TestOptions(), const char* file = nullptr);
+
+class TestRegistrar {
+public:
+    TestRegistrar(const char* suite, const char* name, TestFunction func, const TestOptions& options,
+                  const char* file) {
+        register_test(suite, name, func, options, file);
+    }
+};
+
+#define TEST(suite, name) \
+    void suite##_##name##_Test(); \
+    static TestRegistrar suite##_##name##_registrar(#suite, #name, suite##_##name##_Test, TestOptions(), __FILE__); \
+    void suite##_##name##_Test()
+
+#define TEST_WITH_OPTIONS(suite, name, options) \
+    void suite##_##name##_Test(); \
+    static TestRegistrar suite##_##name##_registrar(#suite, #name, suite##_##name##_Test, options, __FILE__); \
+    void suite##_##name##_Test()
+
+// RUN_TEST(func) or RUN_TEST(func, options)
+#define RUN_TEST(...) TEST_RUN_TEST_(__VA_ARGS__, TestOptions(), )
+#define TEST_RUN_TEST_(test_func, options, ...) \
+    register_test(#test_func, test_func, options, __FILE__)
+
+// Suite descriptors. Each test_*.cpp declares the suite it implements once:
+//
+//     TEST_SUITE(argument_parsing, "Argument Parsing Tests", "argument_parsing_report.txt");
+//
+// optionally followed by a note printed under the banner and an epilogue
+// called with the suite's failed assertion count. The shared main() in
+// suite_main.cpp runs every linked suite, so the same sources build one binary
+// per suite or, linked together, bootgen_all_tests with --suite=NAME[,NAME].
+typedef void (*SuiteEpilogue)(int failedAssertions);
+
+class TestSuiteRegistrar {
+public:
+    TestSuiteRegistrar(const char* name, const char* title, const char* reportFile, const char* file,
+                       const char* note, SuiteEpilogue epilogue);
+};
+
+#define TEST_SUITE(...) TEST_SUITE_(__VA_ARGS__, nullptr, nullptr, )
+#define TEST_SUITE_(name, title, reportFile, note, epilogue, ...) \
+    static TestSuiteRegistrar name##_suite_registrar(#name, title, reportFile, __FILE__, note, epilogue)
+
+// Microbenchmarks. BENCHMARK(Suite, Name) registers a benchmark that is run
+// and filtered like a test; only the KeepRunning() loop is timed:
+//
+//     BENCHMARK(Parser, ParseArgs) {
+//         MockOptions options;
+//         while (state.KeepRunning()) {
+//             options.ParseArgs(argc, argv);
+//             DoNotOptimize(options);
+//         }
+//     }
+//
+// The runner warms the body up and grows the iteration count until one batch
+// takes the target sample time (--bench-time), then times --bench-samples
+// batches and reports median, p90, p99 and MAD of the time per iteration.
+class BenchmarkState {
+public:
+    explicit BenchmarkState(uint64_t iterations) : iterations_(iterations), remaining_(iterations) {}
+
+    bool KeepRunning() {
+        if (remaining_ > 0) {
+            if (remaining_-- == iterations_) start_timer();
+            return true;
+        }
+        stop_timer();
+        return false;
+    }
+
+    uint64_t iterations() const { return iterations_; }
+    bool finished() const { return finished_; }
+    std::chrono::nanoseconds elapsed() const { return elapsed_; }
+
+private:
+    void start_timer();
+    void stop_timer();
+
+    uint64_t iterations_;
+    uint64_t remaining_;
+    uint64_t startTicks_ = 0;
+    bool finished_ = false;
+    std::chrono::nanoseconds elapsed_{0};
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState&);
+
+void register_benchmark(const std::string& suite, const std::string& name, BenchmarkFunction func,
+                        const char* file = nullptr);
+
+class BenchmarkRegistrar {
+public:
+    BenchmarkRegistrar(const char* suite, const char* name, BenchmarkFunction func, const char* file) {
+        register_benchmark(suite, name, func, file);
+    }
+};
+
+#define BENCHMARK(suite, name) \
+    void suite##_##name##_Benchmark(BenchmarkState& state); \
+    static BenchmarkRegistrar suite##_##name##_bench_registrar(#suite, #name, suite##_##name##_Benchmark, __FILE__); \
+    void suite##_##name##_Benchmark(BenchmarkState& state)
+
+// Keeps the compiler from discarding a value computed only for timing
+void benchmark_escape(const void* pointer);
+
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    benchmark_escape(&value);
+#endif
+}
+
+// Forces pending writes to memory to be treated as observable
+inline void ClobberMemory() {
+#if defined(__GNUC__)
+    asm volatile("" : : : "memory");
+#else
+    benchmark_escape(nullptr);
+#endif
+}
+
+// Timeline tracing. With --trace=FILE the runner writes a Chrome trace-event
+// JSON file (chrome://tracing, ui.perfetto.dev) with a span per test, per
+// test phase and per worker thread. TRACE_SCOPE("name") adds a span covering
+// the rest of the enclosing block; it costs one branch when tracing is off.
+namespace test_internal {
+
+extern bool g_trace_enabled;
+
+uint64_t trace_clock();
+void trace_span(const char* name, const char* category, uint64_t startNs);
+
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* category)
+        : name_(name), category_(category), start_(g_trace_enabled ? trace_clock() : 0) {}
+    ~TraceScope() {
+        if (start_) trace_span(name_, category_, start_);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    uint64_t start_;
+};
+
+} // namespace test_internal
+
+#define TEST_TRACE_CONCAT_(a, b) a##b
+#define TEST_TRACE_CONCAT(a, b) TEST_TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+    test_internal::TraceScope TEST_TRACE_CONCAT(trace_scope_, __LINE__)(name, "code")
+
+// Runs the registered tests and merges the results into the global counters.
+// Recognised options: --jobs N / -j N (0 = one worker per hardware thread) and
+// --isolate, which runs each test in a child forked from a pre-forked zygote so
+// a crashing test is reported as CRASHED instead of taking the binary down.
+// --list prints the selected tests and exits; --filter and --exclude take
+// ':'-separated glob patterns ('*', '?') matched against "Suite.Name".
+// --verbose prints passing assertions too; --timer=tsc times tests with the
+// calibrated time-stamp counter instead of steady_clock. BOOTGEN_TEST_JOBS,
+// BOOTGEN_TEST_ISOLATE=1, BOOTGEN_TEST_FILTER, BOOTGEN_TEST_VERBOSE=1 and
+// BOOTGEN_TEST_TIMER set the defaults. See --help for timeout, sharding,
+// benchmark, profiling, tracing and JSON Lines / JUnit report options.
+void run_registered_tests(int argc, char* argv[]);
+
+// main() of every test binary: prints the banner, runs the tests of the
+// selected suites (--suite=NAME[,NAME], --list-suites; default all linked
+// suites) and writes each suite's report. Returns the exit code.
+int run_test_suites(int argc, char* argv[]);
 
 // Test report functions
 void generate_test_report(const std::string& filename = "test_report.txt");
@@ -0,0 +1,199 @@
+/******************************************************************************
+* Copyright 2015-2022 Xilinx, Inc.
+* Copyright 2022-2023 Advanced Micro Devices, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+******************************************************************************/
+
+#include "test_framework.h"
+#include "test_statistics.h"
+#include "test_history.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Self-tests for the framework's own helpers, checked against values worked
+// out by hand so that a regression cannot hide behind the code it tests
+
+TEST(FrameworkSelfTest, MannWhitney_TiedRanks) {
+    // Pooled and ranked:  1r  2s 2r  3s 3s 3r  4r  5s
+    //                     1   2.5    5          7   8
+    // Sample rank sum 2.5 + 5 + 5 + 8 = 20.5, so U = 20.5 - 4 * 5 / 2 = 10.5
+    std::vector<double> sample = {2.0, 3.0, 3.0, 5.0};
+    std::vector<double> reference = {1.0, 2.0, 3.0, 4.0};
+    RankSumTest test = mann_whitney_greater(sample, reference);
+    EXPECT_LT(std::fabs(test.u - 10.5), 1e-12);
+
+    // Ties of two and three give sum(t^3 - t) = 6 + 24 = 30, so the variance
+    // is 16 / 12 * (9 - 30 / 56) = 11.2857 and, with the continuity
+    // correction, z = (10.5 - 8 - 0.5) / sqrt(11.2857) = 0.59534
+    EXPECT_LT(std::fabs(test.z - 0.5953406), 1e-6);
+    EXPECT_LT(std::fabs(test.pGreater - 0.2758079), 1e-6);
+
+    // Two-sided, the correction moves |U - 8| = 2.5 toward the mean either
+    // way, so swapping the samples (U = 5.5) gives the same z and p = 0.55162
+    EXPECT_LT(std::fabs(test.zTwoSided - 0.5953406), 1e-6);
+    EXPECT_LT(std::fabs(test.pTwoSided - 0.5516159), 1e-6);
+    RankSumTest swapped = mann_whitney_greater(reference, sample);
+    EXPECT_LT(std::fabs(swapped.u - 5.5), 1e-12);
+    EXPECT_LT(std::fabs(swapped.zTwoSided - test.zTwoSided), 1e-12);
+    EXPECT_LT(std::fabs(swapped.pTwoSided - test.pTwoSided), 1e-12);
+}
+
+TEST(FrameworkSelfTest, MannWhitney_AllTied) {
+    // Every value tied leaves no variance; the test reports no evidence
+    std::vector<double> values = {4.0, 4.0, 4.0};
+    RankSumTest test = mann_whitney_greater(values, values);
+    EXPECT_LT(std::fabs(test.u - 4.5), 1e-12);
+    EXPECT_EQ(1.0, test.pGreater);
+}
+
+TEST(FrameworkSelfTest, MannWhitney_SeparatedSamples) {
+    // Every sample value beats every reference value: U = n1 * n2
+    std::vector<double> sample = {11, 12, 13, 14, 15, 16, 17, 18};
+    std::vector<double> reference = {1, 2, 3, 4, 5, 6, 7, 8};
+    RankSumTest test = mann_whitney_greater(sample, reference);
+    EXPECT_LT(std::fabs(test.u - 64.0), 1e-12);
+    EXPECT_LT(test.pGreater, 0.001);
+
+    RankSumTest reversed = mann_whitney_greater(reference, sample);
+    EXPECT_LT(std::fabs(reversed.u), 1e-12);
+    EXPECT_GT(reversed.pGreater, 0.999);
+}
+
+TEST(FrameworkSelfTest, MedianInterval_TenValues) {
+    // For n = 10 the 2nd and 9th order statistics cover the median with
+    // probability 1 - 2 * (1 + 10) / 1024 = 0.978515625; the 3rd and 8th
+    // only reach 1 - 2 * 56 / 1024 = 0.890625, short of 95%
+    std::vector<double> values = {10, 3, 7, 1, 9, 5, 2, 8, 6, 4};
+    MedianInterval interval = median_interval(values, 0.95);
+    EXPECT_EQ(2.0, interval.low);
+    EXPECT_EQ(9.0, interval.high);
+    EXPECT_LT(std::fabs(interval.coverage - 0.978515625), 1e-12);
+}
+
+TEST(FrameworkSelfTest, MedianInterval_SmallSamples) {
+    // Six values: the full range covers with 1 - 2 / 64 = 0.96875
+    std::vector<double> six = {6, 1, 5, 2, 4, 3};
+    MedianInterval interval = median_interval(six, 0.95);
+    EXPECT_EQ(1.0, interval.low);
+    EXPECT_EQ(6.0, interval.high);
+    EXPECT_LT(std::fabs(interval.coverage - 0.96875), 1e-12);
+
+    // Five values cannot reach 95%: the full range with 1 - 2 / 32 = 0.9375
+    std::vector<double> five = {5, 1, 4, 2, 3};
+    interval = median_interval(five, 0.95);
+    EXPECT_EQ(1.0, interval.low);
+    EXPECT_EQ(5.0, interval.high);
+    EXPECT_LT(std::fabs(interval.coverage - 0.9375), 1e-12);
+
+    // A single value is its own interval and says nothing about the median
+    interval = median_interval(std::vector<double>(1, 7.0), 0.95);
+    EXPECT_EQ(7.0, interval.low);
+    EXPECT_EQ(7.0, interval.high);
+    EXPECT_EQ(0.0, interval.coverage);
+}
+
+namespace {
+
+std::string history_file(const std::vector<std::vector<perf_history::Measurement> >& runs) {
+    std::string data(perf_history::kMagic, sizeof(perf_history::kMagic));
+    perf_history::Store store;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        store.parse(data);
+        data += perf_history::encode_run(store.strings, "commit" + std::to_string(i), 1000 + i, runs[i]);
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(FrameworkSelfTest, History_RoundTrip) {
+    std::vector<perf_history::Measurement> first = {{"Bench.Parse", "ns", 12.5}, {"Bench.Parse", "allocs", 2.0}};
+    std::vector<perf_history::Measurement> second = {{"Bench.Parse", "ns", 11.0}, {"Bench.Load", "ns", 40.0}};
+    std::string data = history_file({first, second});
+
+    perf_history::Store store;
+    EXPECT_TRUE(store.parse(data));
+    EXPECT_EQ(data.size(), store.validBytes);
+
+    // Names are stored once, numbered in order of first use
+    EXPECT_EQ(6u, store.strings.size());
+    EXPECT_EQ(std::string("commit0"), store.name(0));
+    EXPECT_EQ(std::string("Bench.Parse"), store.name(1));
+    EXPECT_EQ(std::string("ns"), store.name(2));
+    EXPECT_EQ(std::string("allocs"), store.name(3));
+    EXPECT_EQ(std::string("commit1"), store.name(4));
+    EXPECT_EQ(std::string("Bench.Load"), store.name(5));
+
+    EXPECT_EQ(2u, store.runs.size());
+    EXPECT_EQ(4u, store.runs[1].commit);
+    EXPECT_EQ(1001, store.runs[1].time);
+
+    EXPECT_EQ(4u, store.samples.size());
+    EXPECT_EQ(0u, store.samples[1].run);
+    EXPECT_EQ(3u, store.samples[1].metric);
+    EXPECT_EQ(2.0, store.samples[1].value);
+    EXPECT_EQ(1u, store.samples[3].run);
+    EXPECT_EQ(5u, store.samples[3].test);
+    EXPECT_EQ(40.0, store.samples[3].value);
+}
+
+TEST(FrameworkSelfTest, History_TornLastRecord) {
+    std::vector<perf_history::Measurement> run = {{"Bench.Parse", "ns", 12.5}};
+    std::string data = history_file({run, run});
+    const size_t kSampleRecordBytes = 5 + 16;
+
+    // The second run's sample is cut short: it is ignored, and validBytes
+    // marks where the next append overwrites it
+    perf_history::Store store;
+    EXPECT_TRUE(store.parse(data.substr(0, data.size() - 3)));
+    EXPECT_EQ(data.size() - kSampleRecordBytes, store.validBytes);
+    EXPECT_EQ(2u, store.runs.size());
+    EXPECT_EQ(1u, store.samples.size());
+}
+
+TEST(FrameworkSelfTest, History_TornMagic) {
+    // Part of the magic is an empty store; anything else is not a store
+    perf_history::Store store;
+    EXPECT_TRUE(store.parse(std::string(perf_history::kMagic, 3)));
+    EXPECT_EQ(0u, store.validBytes);
+    EXPECT_TRUE(store.runs.empty());
+    EXPECT_FALSE(store.parse("BGX"));
+    EXPECT_FALSE(store.parse("BGHIST2\n"));
+
+#ifndef _WIN32
+    // Appending to such a file rewrites it as a proper store
+    std::string path = "framework_selftest_history_" + std::to_string(::getpid()) + ".bin";
+    {
+        std::ofstream out(path.c_str(), std::ios::binary);
+        out.write(perf_history::kMagic, 3);
+    }
+    std::vector<perf_history::Measurement> run = {{"Bench.Parse", "ns", 12.5}};
+    EXPECT_TRUE(perf_history::append_run(path, "commit0", 1000, run));
+    EXPECT_TRUE(store.read(path));
+    std::remove(path.c_str());
+    EXPECT_EQ(history_file({run}).size(), store.validBytes);
+    EXPECT_EQ(1u, store.runs.size());
+    EXPECT_EQ(1u, store.samples.size());
+#endif
+}
+
+TEST_SUITE(framework_selftest, "Framework Self-Tests", "framework_selftest_report.txt");
@@ -0,0 +1,224 @@
+/******************************************************************************
+* Copyright 2015-2022 Xilinx, Inc.
+* Copyright 2022-2023 Advanced Micro Devices, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+******************************************************************************/
+
+#ifndef TEST_HISTORY_H
+#define TEST_HISTORY_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Append-only performance history shared by the test binaries (writer, via
+// --history-store) and bootgen_history (reader). The file is the magic
+// "BGHIST1\n" followed by records, each a kind byte, a uint32 payload size and
+// the payload, in host byte order:
+//
+//   kString  the bytes of a test or metric name or a commit id; strings are
+//            numbered in the order they appear, so each is stored only once
+//   kRun     uint32 commit string, int64 Unix time; starts a run
+//   kSample  uint32 test string, uint32 metric string, double value; belongs
+//            to the latest run
+//
+// Readers skip kinds they do not know and ignore a truncated last record, so
+// a writer killed halfway through an append costs only that append. A file
+// holding only part of the magic (the first write was cut short) reads as an
+// empty store.
+namespace perf_history {
+
+const char kMagic[8] = { 'B', 'G', 'H', 'I', 'S', 'T', '1', '\n' };
+
+enum RecordKind : uint8_t {
+    kString = 1,
+    kRun = 2,
+    kSample = 3
+};
+
+struct Run {
+    uint32_t commit = 0;
+    int64_t time = 0;
+};
+
+struct Sample {
+    uint32_t run = 0;
+    uint32_t test = 0;
+    uint32_t metric = 0;
+    double value = 0.0;
+};
+
+// One measurement to append
+struct Measurement {
+    std::string test;
+    std::string metric;
+    double value;
+};
+
+struct Store {
+    std::vector<std::string> strings;
+    std::vector<Run> runs;
+    std::vector<Sample> samples;
+    size_t validBytes = 0;      // Length of the well-formed prefix of the file
+
+    // Parses a whole file image; false if it is not a history store
+    bool parse(const std::string& data) {
+        *this = Store();
+        if (data.size() < sizeof(kMagic)) return std::memcmp(data.data(), kMagic, data.size()) == 0;
+        if (std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) return false;
+        size_t pos = sizeof(kMagic);
+        validBytes = pos;
+        while (pos + 5 <= data.size()) {
+            uint8_t kind = static_cast<uint8_t>(data[pos]);
+            uint32_t size;
+            std::memcpy(&size, data.data() + pos + 1, sizeof(size));
+            if (data.size() - pos - 5 < size) break;
+            const char* payload = data.data() + pos + 5;
+            if (kind == kString) {
+                strings.push_back(std::string(payload, size));
+            } else if (kind == kRun && size >= 12) {
+                Run run;
+                std::memcpy(&run.commit, payload, 4);
+                std::memcpy(&run.time, payload + 4, 8);
+                runs.push_back(run);
+            } else if (kind == kSample && size >= 16 && !runs.empty()) {
+                Sample sample;
+                sample.run = static_cast<uint32_t>(runs.size() - 1);
+                std::memcpy(&sample.test, payload, 4);
+                std::memcpy(&sample.metric, payload + 4, 4);
+                std::memcpy(&sample.value, payload + 8, 8);
+                samples.push_back(sample);
+            }
+            pos += 5 + size;
+            validBytes = pos;
+        }
+        return true;
+    }
+
+    bool read(const std::string& path) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if (!in.is_open()) return false;
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return parse(data);
+    }
+
+    const std::string& name(uint32_t id) const {
+        static const std::string unknown = "?";
+        return id < strings.size() ? strings[id] : unknown;
+    }
+};
+
+inline void put_record(std::string& out, RecordKind kind, const void* payload, uint32_t size) {
+    out.push_back(static_cast<char>(kind));
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.append(static_cast<const char*>(payload), size);
+}
+
+// Encodes a run for a store whose strings so far are 'known'; new names are
+// defined in front of the records that use them
+inline std::string encode_run(const std::vector<std::string>& known, const std::string& commit, int64_t time,
+                              const std::vector<Measurement>& measurements) {
+    std::map<std::string, uint32_t> ids;
+    for (size_t i = 0; i < known.size(); ++i) {
+        ids.insert(std::make_pair(known[i], static_cast<uint32_t>(i)));
+    }
+    std::string out;
+    uint32_t next_id = static_cast<uint32_t>(known.size());
+    auto intern = [&ids, &out, &next_id](const std::string& text) {
+        auto found = ids.find(text);
+        if (found != ids.end()) return found->second;
+        uint32_t id = next_id++;
+        ids[text] = id;
+        put_record(out, kString, text.data(), static_cast<uint32_t>(text.size()));
+        return id;
+    };
+
+    char run[12];
+    uint32_t commit_id = intern(commit);
+    std::memcpy(run, &commit_id, 4);
+    std::memcpy(run + 4, &time, 8);
+    put_record(out, kRun, run, sizeof(run));
+    for (const Measurement& measurement : measurements) {
+        char sample[16];
+        uint32_t test = intern(measurement.test);
+        uint32_t metric = intern(measurement.metric);
+        std::memcpy(sample, &test, 4);
+        std::memcpy(sample + 4, &metric, 4);
+        std::memcpy(sample + 8, &measurement.value, 8);
+        put_record(out, kSample, sample, sizeof(sample));
+    }
+    return out;
+}
+
+#ifndef _WIN32
+// Appends one run under an exclusive lock, so suites that the runner starts in
+// parallel can share a store. A torn record left by a killed writer is cut off
+// first. Returns false with errno set on failure.
+inline bool append_run(const std::string& path, const std::string& commit, int64_t time,
+                       const std::vector<Measurement>& measurements) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0) return false;
+    bool ok = ::flock(fd, LOCK_EX) == 0;
+
+    std::string data;
+    char buffer[65536];
+    ssize_t got;
+    while (ok && (got = ::read(fd, buffer, sizeof(buffer))) != 0) {
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+        } else {
+            data.append(buffer, static_cast<size_t>(got));
+        }
+    }
+
+    Store store;
+    if (ok && !store.parse(data)) {
+        errno = EINVAL;     // Not a history store; leave it alone
+        ok = false;
+    }
+    std::string out;
+    if (store.validBytes == 0) out.append(kMagic, sizeof(kMagic));     // New file or torn magic
+    out += encode_run(store.strings, commit, time, measurements);
+    if (ok && store.validBytes < data.size()) ok = ::ftruncate(fd, static_cast<off_t>(store.validBytes)) == 0;
+    if (ok) ok = ::lseek(fd, static_cast<off_t>(store.validBytes), SEEK_SET) >= 0;
+    for (size_t done = 0; ok && done < out.size();) {
+        ssize_t wrote = ::write(fd, out.data() + done, out.size() - done);
+        if (wrote < 0 && errno == EINTR) continue;
+        ok = wrote > 0;
+        if (ok) done += static_cast<size_t>(wrote);
+    }
+    int saved_errno = errno;
+    ::close(fd);    // Releases the lock
+    errno = saved_errno;
+    return ok;
+}
+#endif
+
+} // namespace perf_history
+
+#endif // TEST_HISTORY_H
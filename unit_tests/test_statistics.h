@@ -0,0 +1,179 @@
+/******************************************************************************
+* Copyright 2015-2022 Xilinx, Inc.
+* Copyright 2022-2023 Advanced Micro Devices, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+******************************************************************************/
+
+#ifndef TEST_STATISTICS_H
+#define TEST_STATISTICS_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+// Robust statistics over benchmark samples. Timing distributions are skewed
+// and have outliers (interrupts, page faults), so summaries are built on
+// order statistics rather than mean and standard deviation.
+
+// Linear interpolation between closest ranks; 'sorted' must be ascending
+inline double sorted_percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    if (fraction <= 0.0) return sorted.front();
+    if (fraction >= 1.0) return sorted.back();
+    double rank = fraction * static_cast<double>(sorted.size() - 1);
+    size_t lower = static_cast<size_t>(rank);
+    double weight = rank - static_cast<double>(lower);
+    if (lower + 1 >= sorted.size()) return sorted.back();
+    return sorted[lower] + (sorted[lower + 1] - sorted[lower]) * weight;
+}
+
+inline double median_of(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return sorted_percentile(values, 0.5);
+}
+
+// Median absolute deviation from the median (unscaled)
+inline double median_absolute_deviation(const std::vector<double>& values, double median) {
+    std::vector<double> deviations;
+    deviations.reserve(values.size());
+    for (double value : values) {
+        deviations.push_back(std::fabs(value - median));
+    }
+    return median_of(deviations);
+}
+
+struct SampleSummary {
+    size_t count = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double median = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double mad = 0.0;
+};
+
+inline SampleSummary summarize_samples(const std::vector<double>& samples) {
+    SampleSummary summary;
+    if (samples.empty()) return summary;
+
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double value : sorted) {
+        total += value;
+    }
+    summary.count = sorted.size();
+    summary.min = sorted.front();
+    summary.max = sorted.back();
+    summary.mean = total / static_cast<double>(sorted.size());
+    summary.median = sorted_percentile(sorted, 0.5);
+    summary.p90 = sorted_percentile(sorted, 0.9);
+    summary.p99 = sorted_percentile(sorted, 0.99);
+    summary.mad = median_absolute_deviation(sorted, summary.median);
+    return summary;
+}
+
+struct MedianInterval {
+    double low = 0.0;
+    double high = 0.0;
+    double coverage = 0.0;  // Probability that [low, high] contains the true median
+};
+
+// Distribution-free confidence interval for the median: the k-th smallest and
+// the k-th largest value, with k as large as possible while the binomial
+// coverage still reaches 'confidence'. With too few values for that (fewer
+// than six at 95%) the full range is returned with its smaller coverage.
+inline MedianInterval median_interval(std::vector<double> values, double confidence) {
+    MedianInterval interval;
+    if (values.empty()) return interval;
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+
+    // P(X <= j) for X ~ Binomial(n, 1/2), built up one term at a time
+    double term = std::pow(0.5, static_cast<double>(n));
+    double below = term;                // P(X <= k - 1) for the current k
+    size_t k = 1;
+    interval.coverage = 1.0 - 2.0 * below;
+    while (k < n / 2) {
+        double next_term = term * static_cast<double>(n - k + 1) / static_cast<double>(k);
+        double next_coverage = 1.0 - 2.0 * (below + next_term);
+        if (next_coverage < confidence) break;
+        term = next_term;
+        below += next_term;
+        interval.coverage = next_coverage;
+        k++;
+    }
+    interval.low = values[k - 1];
+    interval.high = values[n - k];
+    return interval;
+}
+
+struct RankSumTest {
+    double u = 0.0;         // Mann-Whitney U of 'sample'
+    double z = 0.0;
+    double pGreater = 1.0;  // One-sided p-value for "sample tends to be larger"
+    double zTwoSided = 0.0; // |z| with the continuity correction toward the mean
+    double pTwoSided = 1.0; // Two-sided p-value for "the samples differ"
+};
+
+// One-sided Mann-Whitney U test of whether 'sample' is stochastically larger
+// than 'reference', plus the two-sided test of whether they differ at all.
+// Uses the normal approximation with tie and continuity corrections, which
+// is adequate from about eight values per side.
+inline RankSumTest mann_whitney_greater(const std::vector<double>& sample, const std::vector<double>& reference) {
+    RankSumTest test;
+    const size_t n1 = sample.size();
+    const size_t n2 = reference.size();
+    if (n1 == 0 || n2 == 0) return test;
+
+    std::vector<std::pair<double, bool> > pooled;   // value, belongs to 'sample'
+    pooled.reserve(n1 + n2);
+    for (double value : sample) pooled.push_back(std::make_pair(value, true));
+    for (double value : reference) pooled.push_back(std::make_pair(value, false));
+    std::sort(pooled.begin(), pooled.end());
+
+    // Tied values share the average of the ranks they span
+    double rank_sum = 0.0;
+    double tie_term = 0.0;
+    for (size_t first = 0; first < pooled.size();) {
+        size_t last = first;
+        while (last + 1 < pooled.size() && pooled[last + 1].first == pooled[first].first) last++;
+        double ties = static_cast<double>(last - first + 1);
+        double rank = (static_cast<double>(first + 1) + static_cast<double>(last + 1)) / 2.0;
+        for (size_t k = first; k <= last; ++k) {
+            if (pooled[k].second) rank_sum += rank;
+        }
+        tie_term += ties * ties * ties - ties;
+        first = last + 1;
+    }
+
+    const double a = static_cast<double>(n1);
+    const double b = static_cast<double>(n2);
+    const double n = a + b;
+    test.u = rank_sum - a * (a + 1.0) / 2.0;
+    double mean = a * b / 2.0;
+    double variance = a * b / 12.0 * ((n + 1.0) - tie_term / (n * (n - 1.0)));
+    if (variance <= 0.0) return test;
+    const double sd = std::sqrt(variance);
+    test.z = (test.u - mean - 0.5) / sd;
+    test.pGreater = 0.5 * std::erfc(test.z / std::sqrt(2.0));
+    test.zTwoSided = std::max(0.0, std::fabs(test.u - mean) - 0.5) / sd;
+    test.pTwoSided = std::erfc(test.zTwoSided / std::sqrt(2.0));
+    return test;
+}
+
+#endif // TEST_STATISTICS_H